@@ -6,7 +6,11 @@
 #ifndef LEVELS_H
 #define LEVELS_H
 
-#include <vector>
+#include <initializer_list>
+
+// Level grid size; world.h's COLS/ROWS match
+constexpr int LEVEL_COLS = 25;
+constexpr int LEVEL_ROWS = 18;
 
 struct PortalDef {
     int x, y;
@@ -30,17 +34,65 @@ struct PebbleDef {
     int pebbleID;
 };
 
+// Fixed-capacity list, brace-initialised like a vector, so the level
+// tables are built by the compiler instead of allocated during static
+// init. Listing more than N entries fails to compile (the throw can never
+// be a constant expression); at runtime push_back reports a full list.
+template <typename T, int N>
+struct FixedList {
+    T items[N] = {};
+    int count = 0;
+
+    constexpr FixedList() = default;
+    constexpr FixedList(std::initializer_list<T> init) {
+        if ((int)init.size() > N) throw "FixedList capacity exceeded";
+        for (const T& item : init) items[count++] = item;
+    }
+
+    constexpr int size() const { return count; }
+    constexpr bool empty() const { return count == 0; }
+    constexpr const T* begin() const { return items; }
+    constexpr const T* end() const { return items + count; }
+    constexpr const T& operator[](int i) const { return items[i]; }
+    constexpr T& operator[](int i) { return items[i]; }
+
+    constexpr bool push_back(const T& item) {
+        if (count == N) return false;
+        items[count++] = item;
+        return true;
+    }
+    constexpr void erase(int i) {
+        for (; i + 1 < count; i++) items[i] = items[i + 1];
+        count--;
+    }
+    constexpr void clear() { count = 0; }
+};
+
+// Enemy path search used on a level (see pathfinding.h)
+enum PathMode {
+    PATH_ASTAR,     // plain 4-connected A*
+    PATH_JPS,       // jump point search, for mostly open floor
+    PATH_INCREMENTAL, // shared LPA* field that routes around pebbles
+    PATH_HIERARCHICAL, // HPA* cluster graph, for levels beyond one screen
+};
+
+const int MAX_LEVEL_PORTALS = 8;
+const int MAX_LEVEL_BERRIES = 32;
+const int MAX_LEVEL_ENEMIES = 64;
+const int MAX_LEVEL_PEBBLES = 64;
+
 struct LevelData {
-    int tiles[18][25];
-    std::vector<PortalDef> portals;
-    std::vector<BerryDef> berries;
-    std::vector<EnemyDef> enemies;
-    std::vector<PebbleDef> pebbles;
+    int tiles[LEVEL_ROWS][LEVEL_COLS];
+    FixedList<PortalDef, MAX_LEVEL_PORTALS> portals;
+    FixedList<BerryDef, MAX_LEVEL_BERRIES> berries;
+    FixedList<EnemyDef, MAX_LEVEL_ENEMIES> enemies;
+    FixedList<PebbleDef, MAX_LEVEL_PEBBLES> pebbles;
+    PathMode pathMode = PATH_ASTAR;
 };
 
 const int NUM_LEVELS = 3;
 
-LevelData Levels[NUM_LEVELS] = {
+inline constexpr LevelData Levels[NUM_LEVELS] = {
     // ========================================================================
     // LEVEL 0 - Starting area with pebbles
     // ========================================================================
@@ -83,7 +135,9 @@ LevelData Levels[NUM_LEVELS] = {
             {5, 8, 0},   // Pebble near spawn
             {12, 5, 1},  // Pebble in middle area
             {18, 10, 2}  // Pebble near portal
-        }
+        },
+        // Open floor - jump point search
+        PATH_JPS
     },
 
     // ========================================================================
@@ -132,7 +186,9 @@ LevelData Levels[NUM_LEVELS] = {
             {12, 8, 5},   // Central pebble
             {10, 5, 6},   // Extra pebble for puzzles
             {14, 5, 7}    // Extra pebble for puzzles
-        }
+        },
+        // Pebbles block ants here, so plan around them
+        PATH_INCREMENTAL
     },
 
     // ========================================================================
@@ -174,8 +230,8 @@ LevelData Levels[NUM_LEVELS] = {
         {
             {5, 8, 3},
             {19, 8, 4},
-            {12, 3, 5},
-            {12, 14, 6}
+            {11, 3, 5},   // next to the central wall, one room each
+            {13, 14, 6}
         },
         // Pebbles - Slide them through the corridor!
         {
@@ -187,8 +243,91 @@ LevelData Levels[NUM_LEVELS] = {
             {21, 3, 13},
             {15, 9, 14},
             {21, 9, 15}
-        }
+        },
+        PATH_INCREMENTAL
     }
 };
 
-#endif // LEVELS_H
\ No newline at end of file
+// ============================================================================
+// VALIDATION
+// ============================================================================
+//
+// Checked at compile time for the built-in tables below, and at runtime
+// for levels loaded from files (see levelfile.h). Each check covers a
+// whole table of NUM_LEVELS levels, since portals link across levels.
+
+namespace levelcheck {
+
+constexpr bool openCell(const LevelData& L, int x, int y) {
+    return x >= 0 && x < LEVEL_COLS && y >= 0 && y < LEVEL_ROWS && L.tiles[y][x] != 1;
+}
+
+template <typename List>
+constexpr bool allOnFloor(const LevelData& L, const List& defs) {
+    for (const auto& d : defs)
+        if (!openCell(L, d.x, d.y)) return false;
+    return true;
+}
+
+constexpr bool entitiesOnFloor(const LevelData* levels) {
+    for (int i = 0; i < NUM_LEVELS; i++) {
+        const LevelData& L = levels[i];
+        if (!allOnFloor(L, L.portals) || !allOnFloor(L, L.berries) ||
+            !allOnFloor(L, L.enemies) || !allOnFloor(L, L.pebbles))
+            return false;
+    }
+    return true;
+}
+
+// Movement and path searches assume nothing walks off the grid
+constexpr bool bordersWalled(const LevelData* levels) {
+    for (int i = 0; i < NUM_LEVELS; i++) {
+        const LevelData& L = levels[i];
+        for (int x = 0; x < LEVEL_COLS; x++)
+            if (L.tiles[0][x] != 1 || L.tiles[LEVEL_ROWS - 1][x] != 1) return false;
+        for (int y = 0; y < LEVEL_ROWS; y++)
+            if (L.tiles[y][0] != 1 || L.tiles[y][LEVEL_COLS - 1] != 1) return false;
+    }
+    return true;
+}
+
+constexpr bool portalIDsUnique(const LevelData* levels) {
+    for (int l = 0; l < NUM_LEVELS; l++) {
+        const LevelData& L = levels[l];
+        for (int i = 0; i < L.portals.size(); i++)
+            for (int j = i + 1; j < L.portals.size(); j++)
+                if (L.portals[i].portalID == L.portals[j].portalID) return false;
+    }
+    return true;
+}
+
+constexpr bool portalLinksResolve(const LevelData* levels) {
+    for (int l = 0; l < NUM_LEVELS; l++) {
+        for (const PortalDef& p : levels[l].portals) {
+            if (p.targetLevel < 0 || p.targetLevel >= NUM_LEVELS) return false;
+            bool found = false;
+            for (const PortalDef& q : levels[p.targetLevel].portals)
+                if (q.portalID == p.targetPortalID) found = true;
+            if (!found) return false;
+        }
+    }
+    return true;
+}
+
+// nullptr when the table passes every check
+constexpr const char* firstProblem(const LevelData* levels) {
+    if (!entitiesOnFloor(levels)) return "level entity outside the grid or inside a wall";
+    if (!bordersWalled(levels)) return "level border has an opening";
+    if (!portalIDsUnique(levels)) return "two portals on one level share an ID";
+    if (!portalLinksResolve(levels)) return "portal targets a missing level or portal ID";
+    return nullptr;
+}
+
+} // namespace levelcheck
+
+static_assert(levelcheck::entitiesOnFloor(Levels), "level entity outside the grid or inside a wall");
+static_assert(levelcheck::bordersWalled(Levels), "level border has an opening");
+static_assert(levelcheck::portalIDsUnique(Levels), "two portals on one level share an ID");
+static_assert(levelcheck::portalLinksResolve(Levels), "portal targets a missing level or portal ID");
+
+#endif // LEVELS_H
@@ -0,0 +1,88 @@
+// ============================================================================
+// arena.cpp
+// PER-TICK BUMP ALLOCATOR AND HEAP ALLOCATION COUNT
+// ============================================================================
+
+#include "arena.h"
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+FrameArena::FrameArena(size_t initialBytes) {
+    addChunk(initialBytes);
+}
+
+FrameArena::~FrameArena() {
+    for (auto& c : chunks) free(c->data);
+}
+
+void FrameArena::addChunk(size_t bytes) {
+    std::unique_ptr<Chunk> chunk(new Chunk());
+    chunk->data = (char*)malloc(bytes);
+    if (!chunk->data) throw std::bad_alloc();
+    chunk->size = bytes;
+    totalBytes += bytes;
+    chunkMallocs++;
+    current.store(chunk.get(), std::memory_order_release);
+    chunks.push_back(std::move(chunk));
+}
+
+void* FrameArena::allocate(size_t bytes, size_t align) {
+    for (;;) {
+        Chunk* c = current.load(std::memory_order_acquire);
+        size_t used = c->used.load(std::memory_order_relaxed);
+        for (;;) {
+            uintptr_t base = (uintptr_t)c->data;
+            size_t start = ((base + used + align - 1) & ~(uintptr_t)(align - 1)) - base;
+            if (start + bytes > c->size) break;
+            if (c->used.compare_exchange_weak(used, start + bytes, std::memory_order_relaxed))
+                return c->data + start;
+        }
+
+        // Full: one thread adds a chunk big enough for this and the next few
+        std::lock_guard<std::mutex> lock(growMutex);
+        if (current.load(std::memory_order_acquire) == c)
+            addChunk(std::max(c->size * 2, bytes + align));
+    }
+}
+
+void FrameArena::reset() {
+    size_t used = 0;
+    for (auto& c : chunks) used += c->used.load(std::memory_order_relaxed);
+    peakBytes = std::max(peakBytes, used);
+
+    if (chunks.size() > 1) {
+        size_t total = totalBytes;
+        for (auto& c : chunks) free(c->data);
+        chunks.clear();
+        totalBytes = 0;
+        addChunk(total);
+    }
+    chunks.front()->used.store(0, std::memory_order_relaxed);
+}
+
+// ----------------------------------------------------------------------------
+// Counting global operator new. The nothrow and array forms end up here
+// too; over-aligned allocations (none in this code) are not counted.
+// ----------------------------------------------------------------------------
+
+static std::atomic<uint64_t> newCalls{0};
+
+uint64_t heapAllocations() {
+    return newCalls.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t n) {
+    newCalls.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t n) {
+    return operator new(n);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
@@ -0,0 +1,90 @@
+// ============================================================================
+// arena.h
+// PER-TICK BUMP ALLOCATOR AND HEAP ALLOCATION COUNT
+// ============================================================================
+
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// Bump allocator for scratch that only lives until the end of a tick.
+// Allocation is an atomic add, so jobs of the same tick can share one
+// arena; nothing is freed until reset(). When a tick needs more than the
+// first chunk it takes more from the heap, and the next reset() merges
+// them into one chunk that size, so from then on ticks allocate nothing.
+class FrameArena {
+public:
+    explicit FrameArena(size_t initialBytes = 64 * 1024);
+    ~FrameArena();
+
+    // Scratch is never shared: a copy is a new, empty arena of the same
+    // capacity, and assigning one arena to another changes neither
+    FrameArena(const FrameArena& o) : FrameArena(o.capacity()) {}
+    FrameArena& operator=(const FrameArena&) { return *this; }
+
+    void* allocate(size_t bytes, size_t align);
+
+    // Everything allocated since the last reset() is gone. Only call when
+    // no other thread is allocating and no arena containers are alive.
+    void reset();
+
+    size_t capacity() const { return totalBytes; }
+    size_t highWater() const { return peakBytes; }
+    int chunkAllocations() const { return chunkMallocs; }    // since construction
+
+private:
+    struct Chunk {
+        char* data;
+        size_t size;
+        std::atomic<size_t> used{0};
+    };
+
+    void addChunk(size_t bytes);
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::atomic<Chunk*> current{nullptr};
+    std::mutex growMutex;
+    size_t totalBytes = 0;
+    size_t peakBytes = 0;
+    int chunkMallocs = 0;
+};
+
+// STL allocator over a FrameArena. deallocate() is a no-op; the memory
+// comes back at the arena's reset(). Without an arena it is the plain
+// heap, so code can take an optional arena and use one container type.
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    ArenaAllocator(FrameArena* arena = nullptr) : arena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& o) : arena(o.arena) {}
+
+    T* allocate(size_t n) {
+        if (arena) return (T*)arena->allocate(n * sizeof(T), alignof(T));
+        return (T*)::operator new(n * sizeof(T));
+    }
+    void deallocate(T* p, size_t) {
+        if (!arena) ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& o) const { return arena == o.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& o) const { return arena != o.arena; }
+
+    FrameArena* arena;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+// operator new calls made by the whole process so far. The game and the
+// benches diff it around a tick to check steady state stays off the heap.
+uint64_t heapAllocations();
@@ -0,0 +1,592 @@
+// ============================================================================
+// bench.cpp
+// HEADLESS BENCHMARKS
+//
+//   g++ -O2 -std=c++17 -o bench bench.cpp world.cpp jobs.cpp pathfinding.cpp
+//       incremental.cpp hpa.cpp pathcache.cpp pathworker.cpp spatialhash.cpp
+//       inventory.cpp arena.cpp clock.cpp levelgen.cpp rollback.cpp intercept.cpp
+//       visibility.cpp nexthop.cpp utils.cpp -lglut -lGL -lpthread
+//   ./bench
+// ============================================================================
+
+#include <cstdio>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "Levels.h"
+#include "pathfinding.h"
+#include "incremental.h"
+#include "hpa.h"
+#include "levelgen.h"
+#include "world.h"
+#include "rollback.h"
+#include "jobs.h"
+
+struct SearchTotals {
+    long long expansions = 0;
+    long long pathCells = 0;
+    int found = 0;
+    int capped = 0;
+    double seconds = 0;
+};
+
+static SearchTotals runQueries(PathMode mode, const PathGrid& grid,
+                               const std::vector<int>& queries)
+{
+    SearchTotals t;
+    GridPath path;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < queries.size(); i += 4) {
+        PathStats stats;
+        if (findPath(mode, grid, queries[i], queries[i+1], queries[i+2], queries[i+3], path, &stats)) {
+            t.found++;
+            t.pathCells += path.size();
+        }
+        t.expansions += stats.expansions;
+        if (stats.capped) t.capped++;
+    }
+    t.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return t;
+}
+
+static PathGrid levelGrid(int level) {
+    PathGrid grid;
+    grid.width = 25;
+    grid.height = 18;
+    grid.tiles = &Levels[level].tiles[0][0];
+    return grid;
+}
+
+// Node expansions of A* vs JPS for random start/goal pairs on each level
+static void benchPathModes() {
+    const int QUERIES = 5000;
+
+    printf("%-6s %-6s %10s %10s %8s %8s %10s\n",
+           "level", "mode", "exp/query", "us/query", "found", "capped", "avg len");
+
+    for (int level = 0; level < NUM_LEVELS; level++) {
+        PathGrid grid = levelGrid(level);
+
+        std::vector<std::pair<int, int>> freeCells;
+        for (int y = 0; y < grid.height; y++)
+            for (int x = 0; x < grid.width; x++)
+                if (grid.walkable(x, y)) freeCells.push_back({x, y});
+
+        std::mt19937 rng(1234 + level);
+        std::vector<int> queries;
+        for (int q = 0; q < QUERIES; q++) {
+            auto a = freeCells[rng() % freeCells.size()];
+            auto b = freeCells[rng() % freeCells.size()];
+            queries.insert(queries.end(), {a.first, a.second, b.first, b.second});
+        }
+
+        const PathMode modes[] = {PATH_ASTAR, PATH_JPS};
+        const char* names[] = {"astar", "jps"};
+        for (int m = 0; m < 2; m++) {
+            SearchTotals t = runQueries(modes[m], grid, queries);
+            printf("%-6d %-6s %10.1f %10.2f %8d %8d %10.2f\n",
+                   level, names[m],
+                   (double)t.expansions / QUERIES,
+                   t.seconds * 1e6 / QUERIES,
+                   t.found, t.capped,
+                   t.found ? (double)t.pathCells / t.found : 0.0);
+        }
+    }
+}
+
+// Cost of reacting to one pebble finishing a slide: LPA* repair of the
+// shared field vs. re-running A* for every enemy on the level
+static void benchPebbleRepair() {
+    const int MOVES = 2000;
+
+    printf("%-6s %14s %14s %12s %12s\n",
+           "level", "lpa exp/move", "astar exp/move", "lpa us/move", "astar us/move");
+
+    for (int level = 0; level < NUM_LEVELS; level++) {
+        PathGrid grid = levelGrid(level);
+        const LevelData& L = Levels[level];
+
+        // Pebbles on a plain copy of the tiles so A* sees them too
+        std::vector<int> tiles(grid.tiles, grid.tiles + grid.width * grid.height);
+        PathGrid blockedGrid = grid;
+        blockedGrid.tiles = tiles.data();
+
+        IncrementalPlanner planner;
+        planner.reset(grid);
+        std::vector<std::pair<int, int>> pebbles;
+        for (const auto& p : L.pebbles) {
+            pebbles.push_back({p.x, p.y});
+            planner.setBlocked(p.x, p.y, true);
+            tiles[p.y * grid.width + p.x] = 1;
+        }
+        const int goalX = 2, goalY = 2;
+        planner.setGoal(goalX, goalY);
+        planner.repair();
+
+        std::mt19937 rng(99 + level);
+        long long lpaExp = 0, astarExp = 0;
+        double lpaSec = 0, astarSec = 0;
+        GridPath path;
+
+        for (int m = 0; m < MOVES; m++) {
+            auto& p = pebbles[rng() % pebbles.size()];
+            static const int dirs[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+            const int* d = dirs[rng() % 4];
+            int nx = p.first + d[0], ny = p.second + d[1];
+            if (!blockedGrid.walkable(nx, ny) || (nx == goalX && ny == goalY)) continue;
+
+            tiles[p.second * grid.width + p.first] = grid.tiles[p.second * grid.width + p.first];
+            tiles[ny * grid.width + nx] = 1;
+
+            auto t0 = std::chrono::steady_clock::now();
+            planner.setBlocked(p.first, p.second, false);
+            planner.setBlocked(nx, ny, true);
+            lpaExp += planner.repair();
+            for (const auto& e : L.enemies)
+                planner.extractPath(e.x, e.y, path);
+            auto t1 = std::chrono::steady_clock::now();
+            for (const auto& e : L.enemies) {
+                PathStats stats;
+                findPathAStar(blockedGrid, e.x, e.y, goalX, goalY, path, &stats);
+                astarExp += stats.expansions;
+            }
+            auto t2 = std::chrono::steady_clock::now();
+
+            lpaSec += std::chrono::duration<double>(t1 - t0).count();
+            astarSec += std::chrono::duration<double>(t2 - t1).count();
+            p = {nx, ny};
+        }
+
+        printf("%-6d %14.1f %14.1f %12.2f %12.2f\n", level,
+               (double)lpaExp / MOVES, (double)astarExp / MOVES,
+               lpaSec * 1e6 / MOVES, astarSec * 1e6 / MOVES);
+    }
+}
+
+// Rooms-and-doors map well beyond one screen: walls every 12 cells with
+// a few doors per wall segment, plus scattered single-cell rubble
+static std::vector<int> makeLargeMap(int w, int h, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<int> tiles(w * h, 0);
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            if (x == 0 || y == 0 || x == w - 1 || y == h - 1 || x % 12 == 0 || y % 12 == 0)
+                tiles[y * w + x] = 1;
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            if ((x % 12 == 0) != (y % 12 == 0) && x > 0 && y > 0 && x < w - 1 && y < h - 1 && rng() % 6 == 0)
+                tiles[y * w + x] = 0;
+    for (int i = 0; i < w * h / 15; i++)
+        tiles[(rng() % h) * w + rng() % w] = 1;
+    return tiles;
+}
+
+// Long-range chases on a large map: capped A* vs HPA*, plus the cost of
+// keeping the cluster graph current as obstacles move
+static void benchHierarchical() {
+    const int W = 240, H = 180, QUERIES = 500;
+    std::vector<int> tiles = makeLargeMap(W, H, 7);
+    PathGrid grid{W, H, tiles.data()};
+
+    std::vector<std::pair<int, int>> freeCells;
+    for (int y = 0; y < H; y++)
+        for (int x = 0; x < W; x++)
+            if (grid.walkable(x, y)) freeCells.push_back({x, y});
+
+    auto t0 = std::chrono::steady_clock::now();
+    HierarchicalPlanner hpa(10);
+    hpa.build(grid);
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    printf("map %dx%d, %d clusters, %d entrance nodes, build %.2f ms\n",
+           W, H, hpa.clusterCount(), hpa.nodeCount(), buildMs);
+
+    std::mt19937 rng(42);
+    std::vector<int> queries;
+    for (int q = 0; q < QUERIES; q++) {
+        auto a = freeCells[rng() % freeCells.size()];
+        auto b = freeCells[rng() % freeCells.size()];
+        queries.insert(queries.end(), {a.first, a.second, b.first, b.second});
+    }
+
+    SearchTotals astar = runQueries(PATH_ASTAR, grid, queries);
+
+    long long abstractExp = 0, refineVisits = 0, hpaCells = 0;
+    int hpaFound = 0;
+    GridPath path;
+    t0 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < queries.size(); i += 4) {
+        HpaStats stats;
+        if (hpa.findPath(queries[i], queries[i+1], queries[i+2], queries[i+3], path, &stats)) {
+            hpaFound++;
+            hpaCells += path.size();
+        }
+        abstractExp += stats.abstractExpansions;
+        refineVisits += stats.refineVisits;
+    }
+    double hpaSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    printf("%-6s %8s %8s %12s %12s %10s\n", "mode", "found", "capped", "exp/query", "cells/query", "us/query");
+    printf("%-6s %8d %8d %12.1f %12s %10.2f\n", "astar", astar.found, astar.capped,
+           (double)astar.expansions / QUERIES, "-", astar.seconds * 1e6 / QUERIES);
+    printf("%-6s %8d %8s %12.1f %12.1f %10.2f\n", "hpa", hpaFound, "-",
+           (double)abstractExp / QUERIES, (double)refineVisits / QUERIES, hpaSec * 1e6 / QUERIES);
+    printf("hpa avg path length %.1f\n", hpaFound ? (double)hpaCells / hpaFound : 0.0);
+
+    // Toggle random cells (pebbles arriving / leaving) and rebuild
+    const int TOGGLES = 2000;
+    long long rebuilt = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < TOGGLES; i++) {
+        auto c = freeCells[rng() % freeCells.size()];
+        hpa.setBlocked(c.first, c.second, !hpa.isBlocked(c.first, c.second));
+        rebuilt += hpa.rebuildDirty();
+    }
+    double toggleSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("cell change: %.1f clusters rebuilt, %.2f us (full build %.2f ms)\n",
+           (double)rebuilt / TOGGLES, toggleSec * 1e6 / TOGGLES, buildMs);
+}
+
+// Whole-tick cost on generated screen-sized levels as the enemy count
+// grows well past anything the shipped levels have. The player stands at
+// the spawn, so enemies keep chasing (and hitting, which reloads the level).
+static void benchEntityScaling() {
+    const int TICKS = 200;
+    const int counts[] = {10, 100, 1000, 10000, 30000};
+    const LevelShape shapes[] = {SHAPE_ARENA, SHAPE_CAVES, SHAPE_MAZE};
+
+    printf("%-6s %8s %8s %8s %10s %10s %10s %8s\n",
+           "shape", "enemies", "pebbles", "berries", "ms/tick", "p99 ms", "steps/tick", "hits");
+
+    for (LevelShape shape : shapes) {
+        for (int count : counts) {
+            LevelGenParams params;
+            params.shape = shape;
+            params.enemies = count;
+            params.pebbleDensity = 0.1f;
+            params.items = 20;
+            params.seed = 11;
+            GeneratedLevel level = generateLevel(params);
+
+            World world;
+            world.verbose = false;
+            world.loadGenerated(level);
+
+            std::vector<double> tickMs;
+            long long steps = 0;
+            int hits = 0;
+            long long clockMs = 0;
+            for (int t = 0; t < TICKS; t++) {
+                clockMs += 16;
+                auto t0 = std::chrono::steady_clock::now();
+                world.step(0, clockMs);
+                tickMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+                steps += world.events.pathSteps;
+                if (world.events.playerHit) hits++;
+            }
+
+            double sum = 0;
+            for (double ms : tickMs) sum += ms;
+            std::sort(tickMs.begin(), tickMs.end());
+            printf("%-6s %8zu %8zu %8zu %10.3f %10.3f %10.1f %8d\n",
+                   shapeName(shape), level.enemies.size(), level.pebbles.size(), level.berries.size(),
+                   sum / TICKS, tickMs[TICKS * 99 / 100], (double)steps / TICKS, hits);
+        }
+    }
+}
+
+// Enemies chasing a player who wanders about: going for the player's cell vs.
+// intercepting with more or fewer candidate cells per tick. Catches count
+// the times an enemy reached the player (each reloads the level); gap is
+// the mean distance in cells from the player to the nearest enemy.
+static void benchIntercept() {
+    const int TICKS = 6000;
+    const LevelShape shapes[] = {SHAPE_ARENA, SHAPE_CAVES};
+    const int horizons[] = {0, 2, 5, 8};       // 0 = CHASE_PLAYER
+    const uint8_t headings[] = {INPUT_UP, INPUT_DOWN, INPUT_LEFT, INPUT_RIGHT,
+                                INPUT_UP | INPUT_LEFT, INPUT_UP | INPUT_RIGHT,
+                                INPUT_DOWN | INPUT_LEFT, INPUT_DOWN | INPUT_RIGHT};
+
+    printf("%-6s %9s %8s %8s %10s %10s %12s\n", "shape", "horizons", "catches", "gap", "ms/tick", "p99 ms", "maps/tick");
+
+    for (LevelShape shape : shapes) {
+        LevelGenParams params;
+        params.shape = shape;
+        params.enemies = 12;
+        params.pebbleDensity = 0;
+        params.seed = 21;
+        GeneratedLevel level = generateLevel(params);
+
+        for (int h : horizons) {
+            World world;
+            world.verbose = false;
+            world.chaseMode = h > 0 ? CHASE_INTERCEPT : CHASE_PLAYER;
+            world.interceptHorizons = h;
+            world.loadGenerated(level);
+
+            std::vector<double> tickMs;
+            int catches = 0;
+            double gapSum = 0;      // cells from the player to the nearest enemy
+            long long mapsBefore = world.distanceMaps.builds();
+            std::mt19937 rng(9);
+            uint8_t input = 0;
+            float lastX = world.player.x, lastY = world.player.y;
+            for (int t = 0; t < TICKS; t++) {
+                auto t0 = std::chrono::steady_clock::now();
+                world.step(input, (t + 1) * 16LL);
+                tickMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+                if (world.events.playerHit) catches++;
+
+                float nearest = 64.0f * TILE_SIZE;
+                for (const Enemy& e : world.enemies)
+                    if (e.alive) nearest = std::min(nearest, std::hypot(e.x - world.player.x, e.y - world.player.y));
+                gapSum += nearest / TILE_SIZE;
+
+                // Wander: a new heading every second or so, or as soon as
+                // a wall stops the player
+                bool stopped = world.player.x == lastX && world.player.y == lastY;
+                if (stopped || t % 60 == 0) input = headings[rng() % 8];
+                lastX = world.player.x;
+                lastY = world.player.y;
+            }
+
+            double sum = 0;
+            for (double ms : tickMs) sum += ms;
+            std::sort(tickMs.begin(), tickMs.end());
+            printf("%-6s %9d %8d %8.2f %10.4f %10.4f %12.2f\n", shapeName(shape), h, catches,
+                   gapSum / TICKS, sum / TICKS, tickMs[TICKS * 99 / 100],
+                   (double)(world.distanceMaps.builds() - mapsBefore) / TICKS);
+        }
+    }
+}
+
+// Fields of view: building one from every floor cell with nothing cached,
+// then the wandering player of benchIntercept with enemies that need to
+// see them (sight) or not. Chasing is the share of enemies after a player.
+static void benchSight() {
+    const int TICKS = 6000;
+    const LevelShape shapes[] = {SHAPE_MAZE, SHAPE_CAVES, SHAPE_ARENA};
+    const uint8_t headings[] = {INPUT_UP, INPUT_DOWN, INPUT_LEFT, INPUT_RIGHT,
+                                INPUT_UP | INPUT_LEFT, INPUT_UP | INPUT_RIGHT,
+                                INPUT_DOWN | INPUT_LEFT, INPUT_DOWN | INPUT_RIGHT};
+
+    printf("%-6s %10s %6s %8s %8s %10s %10s %12s\n", "shape", "field us", "sight", "catches",
+           "chasing", "ms/tick", "p99 ms", "fields/tick");
+
+    for (LevelShape shape : shapes) {
+        LevelGenParams params;
+        params.shape = shape;
+        params.enemies = 12;
+        params.seed = 21;
+        GeneratedLevel level = generateLevel(params);
+
+        World probe;
+        probe.verbose = false;
+        probe.loadGenerated(level);
+        probe.syncOccluders();
+        int cells = 0;
+        auto f0 = std::chrono::steady_clock::now();
+        for (int y = 0; y < ROWS; y++)
+            for (int x = 0; x < COLS; x++)
+                if (probe.levelTiles[y][x] != 1) {
+                    probe.sight.from(x, y);
+                    cells++;
+                }
+        double fieldUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - f0).count() / cells;
+
+        for (int on = 0; on < 2; on++) {
+            World world;
+            world.verbose = false;
+            world.lineOfSight = on;
+            world.loadGenerated(level);
+
+            std::vector<double> tickMs;
+            int catches = 0;
+            long long chasing = 0, alive = 0;
+            long long fieldsBefore = world.sight.builds();
+            std::mt19937 rng(9);
+            uint8_t input = 0;
+            float lastX = world.player.x, lastY = world.player.y;
+            for (int t = 0; t < TICKS; t++) {
+                auto t0 = std::chrono::steady_clock::now();
+                world.step(input, (t + 1) * 16LL);
+                tickMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+                if (world.events.playerHit) catches++;
+
+                for (size_t i = 0; i < world.enemies.size(); i++) {
+                    if (!world.enemies[i].alive) continue;
+                    alive++;
+                    if (!on || world.enemyPaths[i].chasing) chasing++;
+                }
+
+                bool stopped = world.player.x == lastX && world.player.y == lastY;
+                if (stopped || t % 60 == 0) input = headings[rng() % 8];
+                lastX = world.player.x;
+                lastY = world.player.y;
+            }
+
+            double sum = 0;
+            for (double ms : tickMs) sum += ms;
+            std::sort(tickMs.begin(), tickMs.end());
+            printf("%-6s %10.2f %6s %8d %7.0f%% %10.4f %10.4f %12.3f\n", shapeName(shape), fieldUs,
+                   on ? "on" : "off", catches, alive ? 100.0 * chasing / alive : 0.0, sum / TICKS,
+                   tickMs[TICKS * 99 / 100], (double)(world.sight.builds() - fieldsBefore) / TICKS);
+        }
+    }
+}
+
+// Next-hop tables on generated screen-sized levels: building every row on
+// one thread and across a JobSystem, keeping them up to date as single
+// cells open and close, and whole ticks answering enemies from the tables
+// instead of searching (the player stands at the spawn, as above).
+static void benchNextHops() {
+    const int TOGGLES = 2000;
+    const int TICKS = 600;
+    const LevelShape shapes[] = {SHAPE_MAZE, SHAPE_CAVES, SHAPE_ARENA};
+    JobSystem jobs;
+
+    printf("%-6s %8s %10s %10s %12s %10s\n", "shape", "KB", "build ms", "jobs ms", "rows/change", "change us");
+    for (LevelShape shape : shapes) {
+        LevelGenParams params;
+        params.shape = shape;
+        params.seed = 11;
+        GeneratedLevel level = generateLevel(params);
+        PathGrid grid;
+        grid.width = level.width;
+        grid.height = level.height;
+        grid.tiles = level.tiles.data();
+
+        NextHopTable table;
+        auto t0 = std::chrono::steady_clock::now();
+        table.build(grid);
+        table.rebuildDirty();
+        double serialMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        table.clear();
+        t0 = std::chrono::steady_clock::now();
+        table.build(grid);
+        table.rebuildDirty(&jobs);
+        double jobsMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        std::vector<std::pair<int, int>> freeCells;
+        for (int y = 0; y < grid.height; y++)
+            for (int x = 0; x < grid.width; x++)
+                if (grid.walkable(x, y)) freeCells.push_back({x, y});
+
+        std::mt19937 rng(3);
+        long long rebuilt = 0;
+        t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < TOGGLES; i++) {
+            auto c = freeCells[rng() % freeCells.size()];
+            table.setBlocked(c.first, c.second, !table.isBlocked(c.first, c.second));
+            rebuilt += table.rebuildDirty(&jobs);
+        }
+        double toggleUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / TOGGLES;
+        printf("%-6s %8zu %10.2f %10.2f %12.1f %10.2f\n", shapeName(shape), table.bytes() / 1024,
+               serialMs, jobsMs, (double)rebuilt / TOGGLES, toggleUs);
+    }
+
+    printf("\n%-6s %8s %8s %10s %10s %10s %8s\n", "shape", "enemies", "paths", "ms/tick", "p99 ms", "steps/tick", "hits");
+    for (LevelShape shape : shapes) {
+        LevelGenParams params;
+        params.shape = shape;
+        params.enemies = 300;
+        params.pebbleDensity = 0.1f;
+        params.seed = 11;
+        GeneratedLevel level = generateLevel(params);
+
+        for (int tables = 0; tables < 2; tables++) {
+            World world;
+            world.verbose = false;
+            world.nextHopTables = tables;
+            world.loadGenerated(level);
+
+            std::vector<double> tickMs;
+            long long steps = 0;
+            int hits = 0;
+            for (int t = 0; t < TICKS; t++) {
+                auto t0 = std::chrono::steady_clock::now();
+                world.step(0, (t + 1) * 16LL, &jobs);
+                tickMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+                steps += world.events.pathSteps;
+                if (world.events.playerHit) hits++;
+            }
+
+            double sum = 0;
+            for (double ms : tickMs) sum += ms;
+            std::sort(tickMs.begin(), tickMs.end());
+            printf("%-6s %8zu %8s %10.3f %10.3f %10.1f %8d\n", shapeName(shape), level.enemies.size(),
+                   tables ? "tables" : "search", sum / TICKS, tickMs[TICKS * 99 / 100], (double)steps / TICKS, hits);
+        }
+    }
+}
+
+// Cost of saving a played-in world into a RollbackState, copying the state
+// (a ring slot or lookahead scratch copy) and restoring it into the world
+static void benchRollback() {
+    const int TICKS = 600;
+    const int REPS = 20000;
+
+    printf("%-6s %8s %10s %10s %10s %10s\n", "level", "enemies", "path B", "save us", "copy us", "restore us");
+    std::vector<RollbackState> states(2);
+
+    for (int level = 0; level < NUM_LEVELS; level++) {
+        World world;
+        world.verbose = false;
+        world.pathBudget.maxSteps = 0;
+        world.loadLevel(level);
+        std::mt19937 rng(5);
+        uint8_t input = 0;
+        for (int t = 0; t < TICKS; t++) {
+            if (rng() % 20 == 0) input = rng() & INPUT_PLAYER_MASK;
+            world.step(input, (t + 1) * 16LL);
+        }
+
+        RollbackState& a = states[0];
+        RollbackState& b = states[1];
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < REPS; i++) saveState(world, a);
+        auto t1 = std::chrono::steady_clock::now();
+        for (int i = 0; i < REPS; i++) {
+            b = a;
+            a.nowMs += b.nowMs & 1;     // keep the copies from being folded away
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        for (int i = 0; i < REPS; i++) restoreState(world, b);
+        auto t3 = std::chrono::steady_clock::now();
+
+        auto us = [&](std::chrono::steady_clock::duration d) {
+            return std::chrono::duration<double, std::micro>(d).count() / REPS;
+        };
+        printf("%-6d %8zu %10d %10.3f %10.3f %10.3f\n", level, world.enemies.size(),
+               b.numPathBytes, us(t1 - t0), us(t2 - t1), us(t3 - t2));
+    }
+    printf("state size %zu bytes\n", sizeof(RollbackState));
+}
+
+int main() {
+    printf("=== Path search: A* vs jump point search ===\n");
+    benchPathModes();
+
+    printf("\n=== Pebble moved: incremental repair vs. full re-search ===\n");
+    benchPebbleRepair();
+
+    printf("\n=== Large map: A* vs hierarchical (HPA*) ===\n");
+    benchHierarchical();
+
+    printf("\n=== Generated levels: tick time vs entity count ===\n");
+    benchEntityScaling();
+
+    printf("\n=== Enemy chase: player's cell vs. intercept ===\n");
+    benchIntercept();
+
+    printf("\n=== Line of sight: field of view cost, patrol vs. chase ===\n");
+    benchSight();
+
+    printf("\n=== Next-hop tables: build, cell changes, ticks vs. search ===\n");
+    benchNextHops();
+
+    printf("\n=== Rollback state: save, copy, restore ===\n");
+    benchRollback();
+    return 0;
+}
@@ -0,0 +1,55 @@
+// ============================================================================
+// clock.cpp
+// MONOTONIC TIME, GAME CLOCK AND FAKE TIME FOR TESTS
+// ============================================================================
+
+#include "clock.h"
+#include <chrono>
+
+Nanos monotonicNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const TimeSource& steadyTime() {
+    static const SteadyTime source;
+    return source;
+}
+
+GameClock::GameClock(const TimeSource& source)
+    : source(&source), baseSource(source.now()), baseGame(0) {}
+
+Nanos GameClock::now() const {
+    if (isPaused) return baseGame;
+    return baseGame + (Nanos)((source->now() - baseSource) * rate);
+}
+
+// Folds the time run so far into baseGame, so a change of pause or
+// scale only affects what comes after it
+void GameClock::rebase() {
+    Nanos s = source->now();
+    if (!isPaused) baseGame += (Nanos)((s - baseSource) * rate);
+    baseSource = s;
+}
+
+void GameClock::pause() {
+    if (isPaused) return;
+    rebase();
+    isPaused = true;
+}
+
+void GameClock::resume() {
+    if (!isPaused) return;
+    rebase();
+    isPaused = false;
+}
+
+void GameClock::setScale(double scale) {
+    rebase();
+    rate = scale > 0 ? scale : 0;
+}
+
+void GameClock::reset(Nanos gameTime) {
+    baseSource = source->now();
+    baseGame = gameTime;
+}
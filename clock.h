@@ -0,0 +1,80 @@
+// ============================================================================
+// clock.h
+// MONOTONIC TIME, GAME CLOCK AND FAKE TIME FOR TESTS
+// ============================================================================
+
+#pragma once
+
+#include <cstdint>
+
+// Nanoseconds. Differences of these are durations; absolute values only
+// mean something against the same source.
+typedef int64_t Nanos;
+
+const Nanos NANOS_PER_MICRO = 1000;
+const Nanos NANOS_PER_MILLI = 1000 * NANOS_PER_MICRO;
+const Nanos NANOS_PER_SECOND = 1000 * NANOS_PER_MILLI;
+
+// std::chrono::steady_clock in nanoseconds. Never jumps when the system
+// time is changed (NTP, the user), unlike system_clock.
+Nanos monotonicNanos();
+
+// Where a clock reads the time from. The game uses the steady clock;
+// tests and benchmarks hand in a FakeTime and move it themselves.
+class TimeSource {
+public:
+    virtual ~TimeSource() {}
+    virtual Nanos now() const = 0;
+};
+
+class SteadyTime : public TimeSource {
+public:
+    Nanos now() const override { return monotonicNanos(); }
+};
+
+// The process-wide steady source, used wherever none is given
+const TimeSource& steadyTime();
+
+// Time that only moves when told to
+class FakeTime : public TimeSource {
+public:
+    explicit FakeTime(Nanos start = 0) : t(start) {}
+    Nanos now() const override { return t; }
+
+    void set(Nanos when) { t = when; }
+    void advance(Nanos by) { t += by; }
+
+private:
+    Nanos t;
+};
+
+// Game time: starts at 0, stands still while paused and runs `scale`
+// times as fast as its source otherwise. Pausing and rescaling keep the
+// time read so far, so game time never jumps or runs backwards.
+class GameClock {
+public:
+    explicit GameClock(const TimeSource& source = steadyTime());
+
+    Nanos now() const;
+    long long nowMillis() const { return now() / NANOS_PER_MILLI; }
+
+    void pause();
+    void resume();
+    bool paused() const { return isPaused; }
+
+    // 1 is real time, 0.5 half speed; negative scales are taken as 0
+    void setScale(double scale);
+    double scale() const { return rate; }
+
+    // Restarts game time at `gameTime`, keeping pause and scale
+    void reset(Nanos gameTime = 0);
+
+private:
+    void rebase();
+
+    const TimeSource* source;
+    Nanos baseSource;       // source time at the last rebase
+    Nanos baseGame;         // game time at the last rebase
+    double rate = 1.0;
+    bool isPaused = false;
+};
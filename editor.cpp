@@ -0,0 +1,162 @@
+// ============================================================================
+// editor.cpp
+// IN-GAME LEVEL EDITOR AND LEVEL FILE HOT RELOAD
+// ============================================================================
+
+#include "editor.h"
+#include "levelfile.h"
+#include <cstdio>
+#include <algorithm>
+#include <filesystem>
+
+const char* brushName(int placeMode) {
+    switch (placeMode) {
+        case 1:           return "Place";
+        case 2:           return "Burn";
+        case EDIT_WALL:   return "Edit: Wall";
+        case EDIT_FLOOR:  return "Edit: Floor";
+        case EDIT_BERRY:  return "Edit: Berry";
+        case EDIT_ENEMY:  return "Edit: Ant";
+        case EDIT_PEBBLE: return "Edit: Pebble";
+        case EDIT_ERASE:  return "Edit: Erase";
+        default:          return "?";
+    }
+}
+
+void LevelEditor::loadAll() {
+    std::copy(Levels, Levels + NUM_LEVELS, levels);
+
+    for (int i = 0; i < NUM_LEVELS; i++) {
+        std::string error;
+        if (!loadFile(i, error) && !error.empty())
+            printf("Level file ignored: %s\n", error.c_str());
+    }
+
+    watcher.watch(LEVEL_DIR);
+}
+
+// Missing files are not an error: that level keeps its current data
+bool LevelEditor::loadFile(int level, std::string& error) {
+    std::string path = levelFilePath(level);
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) return false;
+
+    LevelData loaded;
+    if (!readLevelFile(path, loaded, error)) return false;
+
+    // Our own saves come back through the watcher unchanged
+    if (levelToText(loaded) == levelToText(levels[level])) return false;
+
+    LevelData candidate[NUM_LEVELS];
+    std::copy(levels, levels + NUM_LEVELS, candidate);
+    candidate[level] = loaded;
+    if (const char* problem = levelcheck::firstProblem(candidate)) {
+        error = path + ": " + problem;
+        return false;
+    }
+
+    levels[level] = loaded;
+    return true;
+}
+
+int LevelEditor::nextID(int brush) const {
+    int maxID = -1;
+    for (const LevelData& L : levels) {
+        if (brush == EDIT_BERRY)
+            for (const auto& d : L.berries) maxID = std::max(maxID, d.berryID);
+        if (brush == EDIT_ENEMY)
+            for (const auto& d : L.enemies) maxID = std::max(maxID, d.enemyID);
+        if (brush == EDIT_PEBBLE)
+            for (const auto& d : L.pebbles) maxID = std::max(maxID, d.pebbleID);
+    }
+    return maxID + 1;
+}
+
+template <typename List>
+static bool hasAt(const List& defs, int gx, int gy) {
+    for (const auto& d : defs)
+        if (d.x == gx && d.y == gy) return true;
+    return false;
+}
+
+template <typename List>
+static void eraseAt(List& defs, int gx, int gy) {
+    for (int i = defs.size() - 1; i >= 0; i--)
+        if (defs[i].x == gx && defs[i].y == gy) defs.erase(i);
+}
+
+bool LevelEditor::apply(int level, int brush, int gx, int gy, std::string& error) {
+    if (gx < 0 || gx >= LEVEL_COLS || gy < 0 || gy >= LEVEL_ROWS) return false;
+
+    LevelData candidate[NUM_LEVELS];
+    std::copy(levels, levels + NUM_LEVELS, candidate);
+    LevelData& L = candidate[level];
+
+    bool full = false;
+    switch (brush) {
+        case EDIT_WALL:
+            L.tiles[gy][gx] = 1;
+            break;
+        case EDIT_FLOOR:
+            L.tiles[gy][gx] = 0;
+            break;
+        case EDIT_BERRY:
+            if (!hasAt(L.berries, gx, gy)) full = !L.berries.push_back({gx, gy, nextID(brush)});
+            break;
+        case EDIT_ENEMY:
+            if (!hasAt(L.enemies, gx, gy)) full = !L.enemies.push_back({gx, gy, nextID(brush)});
+            break;
+        case EDIT_PEBBLE:
+            if (!hasAt(L.pebbles, gx, gy)) full = !L.pebbles.push_back({gx, gy, nextID(brush)});
+            break;
+        case EDIT_ERASE:
+            eraseAt(L.berries, gx, gy);
+            eraseAt(L.enemies, gx, gy);
+            eraseAt(L.pebbles, gx, gy);
+            break;
+        default:
+            return false;
+    }
+
+    if (full) {
+        error = "no room for more of those on this level";
+        return false;
+    }
+    if (const char* problem = levelcheck::firstProblem(candidate)) {
+        error = problem;
+        return false;
+    }
+    if (levelToText(L) == levelToText(levels[level])) return false;
+
+    levels[level] = L;
+    if (!save(level)) {
+        error = "could not write " + levelFilePath(level);
+        return false;
+    }
+    return true;
+}
+
+bool LevelEditor::save(int level) {
+    std::error_code ec;
+    std::filesystem::create_directories(LEVEL_DIR, ec);
+    if (!writeLevelFile(levelFilePath(level), levels[level])) return false;
+
+    // The directory may only just exist
+    watcher.watch(LEVEL_DIR);
+    return true;
+}
+
+std::vector<int> LevelEditor::pollChanges() {
+    std::vector<int> reloaded;
+    for (const std::string& name : watcher.poll()) {
+        int level = levelFromFileName(name);
+        if (level < 0) continue;
+
+        std::string error;
+        if (loadFile(level, error))
+            reloaded.push_back(level);
+        else if (!error.empty())
+            printf("Level file ignored: %s\n", error.c_str());
+    }
+    return reloaded;
+}
@@ -0,0 +1,54 @@
+// ============================================================================
+// editor.h
+// IN-GAME LEVEL EDITOR AND LEVEL FILE HOT RELOAD
+// ============================================================================
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Levels.h"
+#include "filewatch.h"
+
+// Editor brushes, stored in World::placeMode next to 1=place / 2=burn
+enum EditBrush {
+    EDIT_WALL = 3,
+    EDIT_FLOOR,
+    EDIT_BERRY,
+    EDIT_ENEMY,
+    EDIT_PEBBLE,
+    EDIT_ERASE,     // removes berries, enemies and pebbles on the cell
+};
+
+const char* brushName(int placeMode);
+
+// Owns an editable copy of every level. World::levels points at it, so
+// a World loading or reloading a level sees the latest edits.
+//
+// Each edit is checked with the same levelcheck rules the built-in tables
+// pass at compile time, then written to levels/level<N>.txt. Files changed
+// outside the game (a text editor, version control) are picked up by
+// pollChanges() and replace the level if they load and validate.
+class LevelEditor {
+public:
+    LevelData levels[NUM_LEVELS];
+    bool active = false;
+
+    // Built-in levels, replaced by any valid level files on disk
+    void loadAll();
+
+    // Applies `brush` at a cell of `level` and saves the level. False (with
+    // the reason in `error`) if the edit would break validation.
+    bool apply(int level, int brush, int gx, int gy, std::string& error);
+
+    bool save(int level);
+
+    // Levels whose files changed on disk and were reloaded
+    std::vector<int> pollChanges();
+
+private:
+    bool loadFile(int level, std::string& error);
+    int nextID(int brush) const;
+
+    FileWatcher watcher;
+};
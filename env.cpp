@@ -0,0 +1,146 @@
+// ============================================================================
+// env.cpp
+// BATCHED HEADLESS WORLDS FOR BOT TRAINING
+// ============================================================================
+
+#include "env.h"
+#include <algorithm>
+
+// Worlds handed to a thread at a time; one world step is only a few
+// microseconds, so claiming them one by one would be dominated by the atomic.
+static const int CHUNK_SIZE = 8;
+
+VecEnv::VecEnv(int numWorlds, int numThreads, const EnvConfig& cfg)
+    : config(cfg), worlds(numWorlds), clocks(numWorlds, 0), episodeTicks(numWorlds, 0)
+{
+    if (numThreads <= 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (auto& w : worlds)
+        w.verbose = false;
+
+    // The calling thread works too, so spawn one less
+    for (int i = 1; i < numThreads; i++)
+        threads.emplace_back(&VecEnv::workerLoop, this);
+}
+
+VecEnv::~VecEnv() {
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        quitting = true;
+    }
+    wakeCv.notify_all();
+    for (auto& t : threads)
+        t.join();
+}
+
+// ============================================================================
+// THREAD POOL
+// ============================================================================
+
+void VecEnv::runChunks() {
+    for (;;) {
+        int begin = nextIndex.fetch_add(CHUNK_SIZE);
+        if (begin >= jobCount) return;
+        int end = std::min(begin + CHUNK_SIZE, jobCount);
+        for (int i = begin; i < end; i++)
+            (*job)(i);
+    }
+}
+
+void VecEnv::workerLoop() {
+    int seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(poolMutex);
+            wakeCv.wait(lock, [&] { return quitting || generation != seenGeneration; });
+            if (quitting) return;
+            seenGeneration = generation;
+        }
+
+        runChunks();
+
+        {
+            std::lock_guard<std::mutex> lock(poolMutex);
+            finishedWorkers++;
+        }
+        doneCv.notify_one();
+    }
+}
+
+void VecEnv::parallelFor(int count, const std::function<void(int)>& fn) {
+    if (threads.empty() || count <= CHUNK_SIZE) {
+        for (int i = 0; i < count; i++) fn(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        job = &fn;
+        jobCount = count;
+        nextIndex = 0;
+        finishedWorkers = 0;
+        generation++;
+    }
+    wakeCv.notify_all();
+
+    runChunks();
+
+    // Every worker checks in once per generation, so none can still be
+    // inside runChunks when the next job is published
+    std::unique_lock<std::mutex> lock(poolMutex);
+    doneCv.wait(lock, [&] { return finishedWorkers == (int)threads.size(); });
+    job = nullptr;
+}
+
+// ============================================================================
+// EPISODES
+// ============================================================================
+
+void VecEnv::resetWorld(int i) {
+    World& w = worlds[i];
+    w.inventory.clear();
+    w.placeMode = 1;
+    w.fires.clear();
+    w.loadLevel(config.startLevel);
+    w.nextBurnMs = clocks[i];
+    episodeTicks[i] = 0;
+}
+
+void VecEnv::reset(uint8_t* observations) {
+    parallelFor(size(), [&](int i) {
+        resetWorld(i);
+        worlds[i].observe(observations + (size_t)i * OBS_SIZE);
+    });
+}
+
+void VecEnv::step(const EnvAction* actions, uint8_t* observations, float* rewards, uint8_t* dones) {
+    parallelFor(size(), [&](int i) {
+        World& w = worlds[i];
+        const EnvAction& a = actions[i];
+
+        clocks[i] += config.tickMs;
+        w.nowMs = clocks[i];
+
+        if (a.tool == 1 || a.tool == 2) {
+            w.placeMode = a.tool;
+            w.useTool(a.toolX, a.toolY);
+        }
+        w.step(a.input, clocks[i]);
+
+        const TickEvents& ev = w.events;
+        float r = ev.berriesPicked * config.berryReward
+                + ev.enemiesRoasted * config.roastReward;
+        if (ev.playerHit)
+            r += config.hitReward;
+        else if (ev.levelChanged)
+            r += config.portalReward;
+
+        bool done = ev.playerHit || ++episodeTicks[i] >= config.maxEpisodeTicks;
+        if (done) resetWorld(i);
+
+        rewards[i] = r;
+        dones[i] = done ? 1 : 0;
+        w.observe(observations + (size_t)i * OBS_SIZE);
+    });
+}
@@ -0,0 +1,82 @@
+// ============================================================================
+// env.h
+// BATCHED HEADLESS WORLDS FOR BOT TRAINING
+// ============================================================================
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include "world.h"
+
+// One agent decision per world per step
+struct EnvAction {
+    uint8_t input = 0;      // InputBits
+    uint8_t tool = 0;       // 0=none, 1=place bag, 2=burn (same as placeMode)
+    int8_t toolX = 0;       // grid cell for the tool
+    int8_t toolY = 0;
+};
+
+struct EnvConfig {
+    int startLevel = 0;
+    int tickMs = 16;            // simulated time per step, matches the GLUT timer
+    int maxEpisodeTicks = 3600;
+
+    float berryReward = 1.0f;
+    float roastReward = 1.0f;
+    float portalReward = 5.0f;
+    float hitReward = -5.0f;
+};
+
+// N independent worlds stepped together across a fixed thread pool.
+// Each world keeps its own simulated clock, so results do not depend on
+// wall time or on how the worlds are spread across threads.
+class VecEnv {
+public:
+    static const int OBS_SIZE = ROWS * COLS;
+
+    VecEnv(int numWorlds, int numThreads = 0, const EnvConfig& config = EnvConfig());
+    ~VecEnv();
+
+    VecEnv(const VecEnv&) = delete;
+    VecEnv& operator=(const VecEnv&) = delete;
+
+    // Restarts every episode; observations is size()*OBS_SIZE bytes
+    void reset(uint8_t* observations);
+
+    // Applies actions[i] to world i and advances one tick. Finished
+    // episodes report dones[i]=1 and are restarted in place, so the
+    // returned observation is already the first frame of the next one.
+    void step(const EnvAction* actions, uint8_t* observations, float* rewards, uint8_t* dones);
+
+    int size() const { return (int)worlds.size(); }
+    int threadCount() const { return (int)threads.size() + 1; }
+    World& world(int i) { return worlds[i]; }
+
+private:
+    void resetWorld(int i);
+    void parallelFor(int count, const std::function<void(int)>& fn);
+    void workerLoop();
+    void runChunks();
+
+    EnvConfig config;
+    std::vector<World> worlds;
+    std::vector<long long> clocks;
+    std::vector<int> episodeTicks;
+
+    // --- thread pool ---
+    std::vector<std::thread> threads;
+    std::mutex poolMutex;
+    std::condition_variable wakeCv, doneCv;
+    const std::function<void(int)>* job = nullptr;
+    int jobCount = 0;
+    std::atomic<int> nextIndex{0};
+    int generation = 0;
+    int finishedWorkers = 0;
+    bool quitting = false;
+};
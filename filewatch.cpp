@@ -0,0 +1,113 @@
+// ============================================================================
+// filewatch.cpp
+// DIRECTORY CHANGE NOTIFICATION FOR HOT RELOAD
+// ============================================================================
+
+#include "filewatch.h"
+#include <algorithm>
+
+#ifdef __linux__
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+
+FileWatcher::~FileWatcher() {
+    if (fd >= 0) close(fd);
+}
+
+bool FileWatcher::watching() const {
+    return fd >= 0;
+}
+
+bool FileWatcher::watch(const std::string& path) {
+    if (fd >= 0) return true;
+
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return false;
+
+    // Close-after-write catches in-place saves, moved-to catches editors
+    // (and writeLevelFile) that write a temporary file and rename it
+    if (inotify_add_watch(fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    dir = path;
+    return true;
+}
+
+std::vector<std::string> FileWatcher::poll() {
+    std::vector<std::string> changed;
+    if (fd < 0) return changed;
+
+    alignas(inotify_event) char buf[sizeof(inotify_event) + NAME_MAX + 1];
+    for (;;) {
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if (len <= 0) break;
+
+        for (char* p = buf; p < buf + len;) {
+            const inotify_event* ev = (const inotify_event*)p;
+            if (ev->len > 0) {
+                std::string name(ev->name);
+                if (std::find(changed.begin(), changed.end(), name) == changed.end())
+                    changed.push_back(name);
+            }
+            p += sizeof(inotify_event) + ev->len;
+        }
+    }
+    return changed;
+}
+
+#else
+
+#include <chrono>
+
+namespace fs = std::filesystem;
+
+FileWatcher::~FileWatcher() {}
+
+bool FileWatcher::watching() const {
+    return !dir.empty();
+}
+
+bool FileWatcher::watch(const std::string& path) {
+    if (!dir.empty()) return true;
+
+    std::error_code ec;
+    if (!fs::is_directory(path, ec)) return false;
+    dir = path;
+    scan(nullptr);
+    return true;
+}
+
+void FileWatcher::scan(std::vector<std::string>* changed) {
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        if (!entry.is_regular_file(ec)) continue;
+        std::string name = entry.path().filename().string();
+        fs::file_time_type t = entry.last_write_time(ec);
+        if (ec) continue;
+
+        auto it = seen.find(name);
+        if (it == seen.end() || it->second != t) {
+            seen[name] = t;
+            if (changed) changed->push_back(name);
+        }
+    }
+}
+
+std::vector<std::string> FileWatcher::poll() {
+    std::vector<std::string> changed;
+    if (dir.empty()) return changed;
+
+    long long now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (now < nextScanMs) return changed;
+    nextScanMs = now + SCAN_INTERVAL_MS;
+
+    scan(&changed);
+    return changed;
+}
+
+#endif
@@ -0,0 +1,41 @@
+// ============================================================================
+// filewatch.h
+// DIRECTORY CHANGE NOTIFICATION FOR HOT RELOAD
+// ============================================================================
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <filesystem>
+
+// Reports files in one directory that were written or renamed into it.
+// On Linux this is a non-blocking inotify descriptor; elsewhere poll()
+// compares modification times, at most every SCAN_INTERVAL_MS.
+class FileWatcher {
+public:
+    FileWatcher() = default;
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // False if the directory does not exist (yet); safe to call again
+    bool watch(const std::string& dir);
+    bool watching() const;
+
+    // Names (not paths) of files changed since the last call; never blocks
+    std::vector<std::string> poll();
+
+private:
+    std::string dir;
+#ifdef __linux__
+    int fd = -1;
+#else
+    static const long long SCAN_INTERVAL_MS = 250;
+    long long nextScanMs = 0;
+    std::map<std::string, std::filesystem::file_time_type> seen;
+    void scan(std::vector<std::string>* changed);
+#endif
+};
@@ -6,17 +6,25 @@
 #include <GL/glut.h>
 #include <GL/gl.h>
 #include <vector>
-#include <unordered_set>
-#include <utility>
 #include <cmath>
 #include <cstdio>
 #include <iostream>
-#include <chrono>
-#include "Levels.h"
+#include "world.h"
+#include "jobs.h"
 #include "utils.h"
+#include "editor.h"
+#include "sprites.h"
+#include "offscreen.h"
+#include "clock.h"
+#include "replay.h"
+#include "netplay.h"
 #include <map>
 #include <string>
-#include <queue>
+#include <algorithm>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <filesystem>
 
 using std::map;
 using std::string;
@@ -28,849 +36,310 @@ using std::vector;
 #endif
 
 // ============================================================================
-// CONFIGURATION / CONSTANTS
-// ============================================================================
-
-const int TILE_SIZE = 32;
-const int WIN_W = 800;
-const int WIN_H = 600;
-
-int currLevel = 0;
-
-const int COLS = WIN_W / TILE_SIZE; // 25 columns
-const int ROWS = WIN_H / TILE_SIZE; // 18 rows
-
-const float PLAYER_SPEED = 2.0f;
-
-int placeMode = 1; // 1=place, 2=burn
-int bagCount = 10;
-
-bool justTeleported = false;
-int spawnPortalID = -1;
-map<string, int> inventory = {{"berry", 0}, {"item", 10}};
-
-// ============================================================================
-// HELPERS & STRUCTURES
+// GLOBAL STATE
 // ============================================================================
 
-struct PairHash {
-    std::size_t operator()(const std::pair<int, int>& p) const {
-        return std::hash<int>()(p.first) ^ (std::hash<int>()(p.second) << 1);
-    }
-};
+World world;
+JobSystem jobs;
+PathWorker pathWorker;
+LevelEditor editor;
 
-struct Sprite {
-    float x, y;
-    Texture* tex;
-    long long burnEndTime = 0;
-};
-
-struct Portal {
-    int gridX, gridY;
-    int portalID;
-    int targetLevel;
-    int targetPortalID;
-};
+// Enemies drawn in one instanced call when GL 3.3 is there; 'I' switches
+// back to the fixed-function quads for comparison
+InstancedSprites enemySprites;
+bool useInstancing = true;
+vector<InstancedSprites::Instance> enemyInstances;
 
-struct Berry {
-    int gridX, gridY;
-    int berryID;
-};
+bool keys[256] = {false};
 
-struct Enemy {
+// One textured quad; display() replays these so the list can be built on
+// worker threads while GL calls stay on the GLUT thread
+struct DrawCmd {
     float x, y;
-    float speed;
+    GLuint tex;
+    bool rotated;
     float angle;
-    Texture* tex;
-    bool alive;
-};
 
-struct Pebble {
-    float x, y;
-    bool isBeingPushed;
-    long long pushStartTime;
-    float pushDirX, pushDirY;
-    bool isSliding;
-    int targetGridX, targetGridY;
-    float slideProgress;
+    bool operator==(const DrawCmd& o) const {
+        return x == o.x && y == o.y && tex == o.tex && rotated == o.rotated && angle == o.angle;
+    }
+    bool operator!=(const DrawCmd& o) const { return !(*this == o); }
 };
 
-struct BurnCheckEvent {
-    int gridX, gridY;
-};
+struct HudState {
+    int level, placeMode;
+    int items[NUM_ITEM_TYPES];
 
-struct AStarNode {
-    int x, y;
-    float g;
-    float h;
-    int parentX, parentY;
-    
-    float f() const { return g + h; }
-    
-    bool operator>(const AStarNode& other) const {
-        return f() > other.f();
+    bool operator!=(const HudState& o) const {
+        if (level != o.level || placeMode != o.placeMode) return true;
+        for (int i = 0; i < NUM_ITEM_TYPES; i++)
+            if (items[i] != o.items[i]) return true;
+        return false;
     }
 };
 
-struct EnemyPath {
-    std::vector<std::pair<int, int>> path;
-    int currentStep = 0;
-    int framesUntilRecalc = 0;
-    bool isMoving = false;
-    int startGridX = 0, startGridY = 0;
-    int targetGridX = 0, targetGridY = 0;
-    float moveProgress = 0.0f;
-};
-
-// ============================================================================
-// GLOBAL STATE
-// ============================================================================
-
-Texture playerTex, itemTex, wallTex, floorTex, flameTex, holeTex, berryTex, antTex, deadantTex, pebbleTex;
-Sprite player;
-
-std::vector<Sprite> items;
-std::vector<std::vector<int>> fires;
-std::vector<Portal> portals;
-std::vector<Berry> berries;
-std::vector<Enemy> enemies;
-std::vector<Pebble> pebbles;
-
-std::unordered_set<std::pair<int, int>, PairHash> occupiedPositions;
-
-bool keys[256] = {false};
+// Where each layer starts in a command list. Lists with the same layout
+// hold the same entities at the same indices and can be blended.
+struct DrawLayout {
+    size_t oItems, oPebbles, oEnemies, oPlayer;
 
-std::vector<BurnCheckEvent> spreadQueue;
-std::map<Enemy*, EnemyPath> enemyPaths;
-
-int (*levelTiles)[25] = nullptr;
-
-// ============================================================================
-// FORWARD DECLARATIONS
-// ============================================================================
-
-bool checkCollision(float newX, float newY);
-bool checkPebbleCollision(float x, float y, Pebble* ignorePebble = nullptr);
-
-// ============================================================================
-// INVENTORY
-// ============================================================================
-
-void addItemtoinventory(string item, int number) {
-    inventory[item] += number;
-}
-
-// ============================================================================
-// COLLISION
-// ============================================================================
-
-bool checkPebbleCollision(float x, float y, Pebble* ignorePebble) {
-    int gx = x / TILE_SIZE;
-    int gy = y / TILE_SIZE;
-    
-    for (auto& pebble : pebbles) {
-        if (&pebble == ignorePebble) continue;
-        
-        int px = pebble.x / TILE_SIZE;
-        int py = pebble.y / TILE_SIZE;
-        
-        if (gx == px && gy == py) {
-            return true;
-        }
+    bool operator==(const DrawLayout& o) const {
+        return oItems == o.oItems && oPebbles == o.oPebbles &&
+               oEnemies == o.oEnemies && oPlayer == o.oPlayer;
     }
-    return false;
-}
-
-bool checkCollision(float newX, float newY) {
-    int gx = newX / TILE_SIZE;
-    int gy = newY / TILE_SIZE;
+};
 
-    if (gx < 0 || gx >= COLS || gy < 0 || gy >= ROWS)
-        return true;
+// The last two simulation ticks, and the blend of them being presented
+vector<DrawCmd> drawCmds;
+vector<DrawCmd> prevCmds;
+DrawLayout drawLayout = {}, prevLayout = {};
+vector<DrawCmd> frameCmds;
 
-    if (levelTiles[gy][gx] == 1)
-        return true;
+// What the window shows right now. idle() only asks for a redraw when
+// the new frame differs, so an idle screen costs a list compare per frame
+// instead of a full redraw and buffer swap.
+vector<DrawCmd> shownCmds;
+HudState shownHud = {-1, -1, {}};
 
-    // Check pebble collision
-    for (const auto& pebble : pebbles) {
-        int px = pebble.x / TILE_SIZE;
-        int py = pebble.y / TILE_SIZE;
-        if (gx == px && gy == py) {
-            return true;
-        }
-    }
+// Item counts are copied only when the inventory reports them changed
+HudState hud = {0, 0, {}};
+bool hudItemsSynced = false;
 
-    return false;
-}
+// The tile layer only changes with the map, so it is rebuilt per version
+bool tilesBuilt = false;
+uint32_t tilesBuiltVersion = 0;
 
 // ============================================================================
-// PORTAL SYSTEM
+// UPDATE LOOP
 // ============================================================================
 
-void loadPortals() {
-    portals.clear();
-    const std::vector<PortalDef>& defs = Levels[currLevel].portals;
-    bagCount = 10;
-    for (const auto& def : defs) {
-        Portal P;
-        P.gridX = def.x;
-        P.gridY = def.y;
-        P.portalID = def.portalID;
-        P.targetLevel = def.targetLevel;
-        P.targetPortalID = def.targetPortalID;
-        portals.push_back(P);
-        printf("Loaded Portal ID %d at [%d,%d] -> Level %d, PortalID %d\n",
-               P.portalID, P.gridX, P.gridY, P.targetLevel, P.targetPortalID);
-    }
+uint8_t readInputBits() {
+    uint8_t bits = 0;
+    if (keys['w']||keys['W']) bits |= INPUT_UP;
+    if (keys['s']||keys['S']) bits |= INPUT_DOWN;
+    if (keys['a']||keys['A']) bits |= INPUT_LEFT;
+    if (keys['d']||keys['D']) bits |= INPUT_RIGHT;
+    return bits;
 }
 
-void loadBerries() {
-    berries.clear();
-    const std::vector<BerryDef>& defs = Levels[currLevel].berries;
-    for (const auto& def : defs) {
-        Berry B;
-        B.gridX = def.x;
-        B.gridY = def.y;
-        B.berryID = def.berryID;
-        berries.push_back(B);
-        printf("Loaded Berry ID %d at [%d,%d]\n", B.berryID, B.gridX, B.gridY);
-    }
-}
+void buildDrawCommands();
+HudState currentHud();
+
+// The simulation advances in fixed ticks on its own clock, so it plays
+// the same however often frames are presented. idle() runs the ticks game
+// time has paid for, then presents a frame blended between the last two.
+// Game time is real time, paused ('p') or scaled ('-' / '=') by gameClock.
+const long long SIM_TICK_MS = 16;
+const Nanos SIM_TICK_NS = SIM_TICK_MS * NANOS_PER_MILLI;
+const int MAX_CATCHUP_TICKS = 5;        // after a stall, drop time instead of spiralling
+
+// Without vsync, frames are spaced at least this far apart
+const long long MIN_PRESENT_US = 1000000 / 120;
+
+long long simClockMs = 0;               // clock handed to world.step
+GameClock gameClock;
+Nanos lastIdleNs = 0;                   // game time at the last idle()
+Nanos accumulatorNs = 0;
+bool vsync = false;
+
+// Measured spacing of presented frames, reported every few seconds. Only
+// back-to-back presents count, so a still screen is not a hitch. The
+// report also carries the heap allocations per simulation tick, which
+// should sit at zero between path searches.
+struct FramePacing {
+    static const long long REPORT_US = 5000000;
+
+    long long lastPresentUs = 0;
+    long long nextReportUs = 0;
+    vector<float> intervalsMs;
+    long long ticks = 0, tickAllocs = 0, allocFreeTicks = 0;
+
+    void presented(long long nowUs);
+    void report();
+};
 
-void loadEnemies() {
-    enemies.clear();
-    const std::vector<EnemyDef>& defs = Levels[currLevel].enemies;
-    for (const auto& def : defs) {
-        Enemy E;
-        E.x = def.x * TILE_SIZE;
-        E.y = def.y * TILE_SIZE;
-        E.speed = 1.0f;
-        E.angle = 0.0f;
-        E.tex = &antTex;
-        E.alive = true;
-        enemies.push_back(E);
-        printf("Loaded Enemy ID %d at [%d,%d]\n", def.enemyID, def.x, def.y);
-    }
-}
+FramePacing pacing;
 
-void loadPebbles() {
-    pebbles.clear();
-    const std::vector<PebbleDef>& defs = Levels[currLevel].pebbles;
-    for (const auto& def : defs) {
-        Pebble P;
-        P.x = def.x * TILE_SIZE;
-        P.y = def.y * TILE_SIZE;
-        P.isBeingPushed = false;
-        P.pushStartTime = 0;
-        P.pushDirX = 0.0f;
-        P.pushDirY = 0.0f;
-        P.isSliding = false;
-        P.targetGridX = 0;
-        P.targetGridY = 0;
-        P.slideProgress = 0.0f;
-        pebbles.push_back(P);
-        printf("Loaded Pebble ID %d at [%d,%d]\n", def.pebbleID, def.x, def.y);
-    }
-}
+// `game --record <file>` writes the inputs and per-tick state hashes here
+ReplayRecorder recorder;
+string recordPath;
 
-Portal* findPortalByID(int portalID) {
-    for (auto& p : portals)
-        if (p.portalID == portalID)
-            return &p;
-    return nullptr;
+// Edits and reloaded level files are not part of a recording, so either
+// ends it
+void stopRecording(const char* why) {
+    if (!recorder.active()) return;
+    if (recorder.stop(recordPath)) printf("Recording saved to %s (%s)\n", recordPath.c_str(), why);
+    else printf("Cannot write recording %s\n", recordPath.c_str());
 }
 
-// ============================================================================
-// LEVEL LOADING
-// ============================================================================
-
-void loadLevel(int levelIndex, int fromPortalID = -1) {
-    if (levelIndex < 0 || levelIndex >= NUM_LEVELS) {
-        printf("Invalid level: %d\n", levelIndex);
-        return;
+// `game --net ...` plays two players over UDP; see netplay.h
+LockstepSession netSession;
+bool netplay = false;
+
+void tick() {
+    // Level files edited outside the game; the current one is rebuilt
+    // around the player. A network game leaves them for the next one.
+    if (!netplay) {
+        for (int level : editor.pollChanges()) {
+            stopRecording("level file changed");
+            if (level == world.currLevel) world.reloadLevel();
+            printf("Reloaded level %d from disk\n", level);
+        }
     }
 
-    currLevel = levelIndex;
-    levelTiles = Levels[currLevel].tiles;
-
-    items.clear();
-    occupiedPositions.clear();
-    spreadQueue.clear();
-    bagCount = 10;
-
-    loadPortals();
-    loadBerries();
-    loadEnemies();
-    loadPebbles();
-    
-    if (fromPortalID >= 0) {
-        Portal* spawnP = findPortalByID(fromPortalID);
-        if (spawnP) {
-            player.x = spawnP->gridX * TILE_SIZE;
-            player.y = spawnP->gridY * TILE_SIZE;
-            spawnPortalID = fromPortalID;
-            justTeleported = true;
-            printf("Spawned at portal ID %d in level %d\n", fromPortalID, currLevel);
-        } else {
-            player.x = 64;
-            player.y = 64;
-            spawnPortalID = -1;
-            justTeleported = false;
-        }
+    uint8_t input = readInputBits();
+    if (netplay) {
+        // Waiting on the peer: the last tick stays on screen
+        if (!netSession.advance(world, input)) return;
     } else {
-        player.x = 64;
-        player.y = 64;
-        spawnPortalID = -1;
-        justTeleported = false;
+        simClockMs += SIM_TICK_MS;
+        world.step(input, simClockMs, &jobs);
+        recorder.tick(world, input);
     }
 
-    printf("\n=== Loaded Level %d ===\n", currLevel);
-}
-
-// ============================================================================
-// PORTAL + ITEM CHECKS
-// ============================================================================
+    prevCmds = drawCmds;
+    prevLayout = drawLayout;
+    buildDrawCommands();
 
-void checkPortalCollision() {
-    int gx = player.x / TILE_SIZE;
-    int gy = player.y / TILE_SIZE;
+    pacing.ticks++;
+    pacing.tickAllocs += world.events.heapAllocs;
+    if (world.events.heapAllocs == 0) pacing.allocFreeTicks++;
+}
 
-    if (justTeleported && spawnPortalID >= 0) {
-        Portal* spawnP = findPortalByID(spawnPortalID);
-        if (spawnP && (spawnP->gridX != gx || spawnP->gridY-1 != gy)) {
-            justTeleported = false;
-            printf("Player moved off spawn portal -- teleport enabled.\n");
-        }
+// Moving layers are placed `alpha` of the way from the previous tick to
+// the latest. Anything that changed layout, texture or jumped more than a
+// couple of tiles (portals, respawns) is drawn where it is now.
+void blendFrame(float alpha) {
+    frameCmds = drawCmds;
+    if (!(prevLayout == drawLayout) || prevCmds.size() != drawCmds.size())
         return;
-    }
 
-    for (const auto& p : portals) {
-        if (gx == p.gridX && gy == p.gridY-1) {
-            printf("Entered Portal ID %d -- going to Level %d\n", p.portalID, p.targetLevel);
-            loadLevel(p.targetLevel, p.targetPortalID);
-            glutPostRedisplay();
-            return;
-        }
-    }
-}
-
-void checkItemPickup() {
-    int gx = player.x / TILE_SIZE;
-    int gy = player.y / TILE_SIZE;
-    for (auto it = berries.begin(); it != berries.end(); ) {
-        if (gx == it->gridX && gy == it->gridY-1) {
-            printf("pickedup berry\n");
-            addItemtoinventory("berry", 1);
-            it = berries.erase(it);
-            glutPostRedisplay();
-            return;
-        } else {
-            ++it;
-        }
+    const float maxJump = 2.0f * TILE_SIZE;
+    for (size_t i = drawLayout.oItems; i < frameCmds.size(); i++) {
+        const DrawCmd& a = prevCmds[i];
+        DrawCmd& b = frameCmds[i];
+        if (a.tex != b.tex || a.rotated != b.rotated) continue;
+        if (std::fabs(b.x - a.x) > maxJump || std::fabs(b.y - a.y) > maxJump) continue;
+        b.x = a.x + (b.x - a.x) * alpha;
+        b.y = a.y + (b.y - a.y) * alpha;
     }
 }
 
-void checkEnemyCollision() {
-    for (const auto& enemy : enemies) {
-        if (!enemy.alive) continue;
-        float dx = player.x - enemy.x;
-        float dy = player.y - enemy.y;
-        float dist = sqrt(dx * dx + dy * dy);
-        
-        if (dist < TILE_SIZE * 0.8f) {
-            printf("Hit by enemy! Reloading level...\n");
-            loadLevel(currLevel);
-            return;
-        }
-    }
-}
+void idle() {
+    Nanos now = gameClock.now();
+    accumulatorNs += now - lastIdleNs;
+    lastIdleNs = now;
 
-void checkEnemyFire() {
-    for (auto it = enemies.begin(); it != enemies.end(); ) {
-        for (const auto& fire : fires) {
-            float fireX = fire[0] * TILE_SIZE;
-            float fireY = fire[1] * TILE_SIZE;
-            
-            float dx = fireX - it->x;
-            float dy = fireY - it->y;
-            float dist = sqrt(dx * dx + dy * dy);
-            
-            if (dist < TILE_SIZE * 0.8f) {
-                printf("Enemy roasted!\n");
-                it->tex = &deadantTex;
-                it->alive = false;
-                break;
-            }
-        }
-        it++;
+    int ticks = 0;
+    while (accumulatorNs >= SIM_TICK_NS && ticks < MAX_CATCHUP_TICKS) {
+        tick();
+        accumulatorNs -= SIM_TICK_NS;
+        ticks++;
     }
-}
-
-// ============================================================================
-// PEBBLE SYSTEM
-// ============================================================================
-inline void getPlayerFeetGrid(int& gx, int& gy) {
-    const float COLLISION_HEIGHT = TILE_SIZE / 4.0f;
-    const float COLLISION_TOP_OFFSET = TILE_SIZE - COLLISION_HEIGHT;
-
-    float feetX = player.x + TILE_SIZE * 0.5f;
-    float feetY = player.y + COLLISION_TOP_OFFSET + COLLISION_HEIGHT * 0.5f;
+    if (accumulatorNs >= SIM_TICK_NS)
+        accumulatorNs %= SIM_TICK_NS;
 
-    gx = (int)(feetX / TILE_SIZE);
-    gy = (int)(feetY / TILE_SIZE);
-}
+    blendFrame((float)accumulatorNs / SIM_TICK_NS);
 
-void startPushingPebble(float /*playerX*/, float /*playerY*/,
-                        float pushDirX, float pushDirY)
-{
-    int playerGridX, playerGridY;
-    getPlayerFeetGrid(playerGridX, playerGridY);
-
-    int checkGridX = playerGridX + (pushDirX > 0 ? 1 : (pushDirX < 0 ? -1 : 0));
-    int checkGridY = playerGridY + (pushDirY > 0 ? 1 : (pushDirY < 0 ? -1 : 0));
-
-    for (auto& pebble : pebbles) {
-        if (pebble.isSliding) continue;
-
-        int pebbleGridX = (int)(pebble.x / TILE_SIZE);
-        int pebbleGridY = (int)(pebble.y / TILE_SIZE);
-
-        if (pebbleGridX == checkGridX &&
-            pebbleGridY == checkGridY)
-        {
-            if (!pebble.isBeingPushed) {
-                pebble.isBeingPushed = true;
-                pebble.pushStartTime = getCurrentTimeMillis();
-                pebble.pushDirX = pushDirX;
-                pebble.pushDirY = pushDirY;
-
-                printf(
-                    "PUSH pebble at [%d,%d] from feet [%d,%d] dir [%.0f,%.0f]\n",
-                    pebbleGridX, pebbleGridY,
-                    playerGridX, playerGridY,
-                    pushDirX, pushDirY
-                );
-            }
-            return;
-        }
-    }
-}
-
-void stopPushingPebbles() {
-    for (auto& pebble : pebbles) {
-        if (pebble.isBeingPushed) {
-            pebble.isBeingPushed = false;
-            printf("Stopped pushing pebble.\n");
-        }
+    if (frameCmds == shownCmds && !(currentHud() != shownHud)) {
+        // Nothing moves until the next tick at the earliest
+        pacing.lastPresentUs = 0;
+        std::this_thread::sleep_for(std::chrono::nanoseconds(SIM_TICK_NS - accumulatorNs));
+        return;
     }
-}
 
-void updatePebbles() {
-    long long now = getCurrentTimeMillis();
-    
-    for (auto& pebble : pebbles) {
-        // Check if push duration reached 0.5 seconds
-        if (pebble.isBeingPushed && !pebble.isSliding) {
-            if (now - pebble.pushStartTime >= 500) {
-                // Try to slide the pebble
-                int currentGridX = (int)round(pebble.x / TILE_SIZE);
-                int currentGridY = (int)round(pebble.y / TILE_SIZE);
-                
-                int targetX = currentGridX + (int)pebble.pushDirX;
-                int targetY = currentGridY + (int)pebble.pushDirY;
-                
-                printf("Trying to slide pebble from [%d,%d] to [%d,%d]\n", 
-                       currentGridX, currentGridY, targetX, targetY);
-                
-                // Check if target tile is free
-                if (!checkCollision(targetX * TILE_SIZE, targetY * TILE_SIZE) &&
-                    !checkPebbleCollision(targetX * TILE_SIZE, targetY * TILE_SIZE, &pebble)) {
-                    
-                    // Start sliding!
-                    pebble.isSliding = true;
-                    pebble.targetGridX = targetX;
-                    pebble.targetGridY = targetY;
-                    pebble.slideProgress = 0.0f;
-                    pebble.isBeingPushed = false;
-                    printf("Pebble sliding to [%d,%d]!\n", targetX, targetY);
-                } else {
-                    pebble.isBeingPushed = false;
-                    printf("Can't slide pebble - blocked!\n");
-                }
-            }
-        }
-        
-        // Handle sliding animation
-        if (pebble.isSliding) {
-            const float SLIDE_SPEED = 0.1f; // Adjust for faster/slower slide
-            pebble.slideProgress += SLIDE_SPEED;
-            
-            if (pebble.slideProgress >= 1.0f) {
-                // Reached target
-                pebble.x = pebble.targetGridX * TILE_SIZE;
-                pebble.y = pebble.targetGridY * TILE_SIZE;
-                pebble.isSliding = false;
-                pebble.slideProgress = 0.0f;
-                printf("Pebble finished sliding at [%d,%d].\n", pebble.targetGridX, pebble.targetGridY);
-            } else {
-                // Interpolate position - calculate start position from current and target
-                int startGridX = pebble.targetGridX - (int)pebble.pushDirX;
-                int startGridY = pebble.targetGridY - (int)pebble.pushDirY;
-                
-                float startX = startGridX * TILE_SIZE;
-                float startY = startGridY * TILE_SIZE;
-                float targetX = pebble.targetGridX * TILE_SIZE;
-                float targetY = pebble.targetGridY * TILE_SIZE;
-                
-                pebble.x = startX + (targetX - startX) * pebble.slideProgress;
-                pebble.y = startY + (targetY - startY) * pebble.slideProgress;
-            }
+    if (!vsync && pacing.lastPresentUs) {
+        long long wait = pacing.lastPresentUs + MIN_PRESENT_US - getCurrentTimeMicros();
+        if (wait > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(wait));
+            return;     // blend again at the later time before presenting
         }
     }
+    glutPostRedisplay();
 }
 
-// ============================================================================
-// ENEMY AI
-// ============================================================================
-
-float heuristic(int x1, int y1, int x2, int y2) {
-    return abs(x1 - x2) + abs(y1 - y2);
-}
+void FramePacing::presented(long long nowUs) {
+    if (lastPresentUs)
+        intervalsMs.push_back((nowUs - lastPresentUs) / 1000.0f);
+    lastPresentUs = nowUs;
 
-bool findPathAStar(int startX, int startY, int goalX, int goalY, std::vector<std::pair<int, int>>& outPath) {
-    outPath.clear();
-    
-    if (startX == goalX && startY == goalY) return false;
-    if (startX < 0 || startX >= COLS || startY < 0 || startY >= ROWS) return false;
-    if (goalX < 0 || goalX >= COLS || goalY < 0 || goalY >= ROWS) return false;
-    if (levelTiles[goalY][goalX] == 1) return false;
-    
-    std::priority_queue<AStarNode, std::vector<AStarNode>, std::greater<AStarNode>> openSet;
-    bool closedSet[ROWS][COLS] = {false};
-    std::map<std::pair<int,int>, std::pair<int,int>> cameFrom;
-    float gScore[ROWS][COLS];
-    
-    for (int r = 0; r < ROWS; r++) {
-        for (int c = 0; c < COLS; c++) {
-            gScore[r][c] = 1e9;
-        }
+    if (nextReportUs == 0) nextReportUs = nowUs + REPORT_US;
+    if (nowUs >= nextReportUs) {
+        report();
+        nextReportUs = nowUs + REPORT_US;
     }
-    
-    gScore[startY][startX] = 0;
-    openSet.push({startX, startY, 0, heuristic(startX, startY, goalX, goalY), -1, -1});
-    
-    int dirs[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
-    
-    int iterations = 0;
-    const int MAX_ITERATIONS = 500;
-    
-    while (!openSet.empty() && iterations < MAX_ITERATIONS) {
-        iterations++;
-        
-        AStarNode current = openSet.top();
-        openSet.pop();
-        
-        if (closedSet[current.y][current.x]) continue;
-        closedSet[current.y][current.x] = true;
-        
-        if (current.parentX >= 0 && current.parentY >= 0) {
-            cameFrom[{current.x, current.y}] = {current.parentX, current.parentY};
-        }
-        
-        if (current.x == goalX && current.y == goalY) {
-            std::vector<std::pair<int, int>> reversePath;
-            int cx = goalX, cy = goalY;
-            
-            while (cameFrom.count({cx, cy})) {
-                reversePath.push_back({cx, cy});
-                auto parent = cameFrom[{cx, cy}];
-                cx = parent.first;
-                cy = parent.second;
-            }
-            
-            for (int i = reversePath.size() - 1; i >= 0; i--) {
-                outPath.push_back(reversePath[i]);
-            }
-            
-            return true;
-        }
-        
-        for (int i = 0; i < 4; i++) {
-            int nx = current.x + dirs[i][0];
-            int ny = current.y + dirs[i][1];
-            
-            if (nx < 0 || nx >= COLS || ny < 0 || ny >= ROWS) continue;
-            if (levelTiles[ny][nx] == 1) continue;
-            if (closedSet[ny][nx]) continue;
-            
-            float tentativeG = current.g + 1.0f;
-            
-            if (tentativeG < gScore[ny][nx]) {
-                gScore[ny][nx] = tentativeG;
-                float h = heuristic(nx, ny, goalX, goalY);
-                openSet.push({nx, ny, tentativeG, h, current.x, current.y});
-            }
-        }
-    }
-    
-    return false;
 }
 
-void updateEnemies() {
-    for (auto& enemy : enemies) {
-        if (!enemy.alive) continue;
-        
-        if (enemyPaths.find(&enemy) == enemyPaths.end()) {
-            enemyPaths[&enemy] = EnemyPath();
-        }
-        
-        EnemyPath& pathData = enemyPaths[&enemy];
-        
-        int enemyGridX, enemyGridY;
-        if (!pathData.isMoving) {
-            enemyGridX = (int)round(enemy.x / TILE_SIZE);
-            enemyGridY = (int)round(enemy.y / TILE_SIZE);
-        } else {
-            enemyGridX = pathData.startGridX;
-            enemyGridY = pathData.startGridY;
-        }
-        
-        const float COLLISION_HEIGHT = TILE_SIZE / 4.0f;
-        const float COLLISION_TOP_OFFSET = TILE_SIZE - COLLISION_HEIGHT;
-        float playerFeetY = player.y + COLLISION_TOP_OFFSET + (COLLISION_HEIGHT / 2.0f);
-        
-        int playerGridX = (int)(player.x / TILE_SIZE);
-        int playerGridY = (int)(playerFeetY / TILE_SIZE);
-        
-        if (!pathData.isMoving && (pathData.framesUntilRecalc <= 0 || pathData.path.empty())) {
-            std::vector<std::pair<int, int>> newPath;
-            if (findPathAStar(enemyGridX, enemyGridY, playerGridX, playerGridY, newPath)) {
-                pathData.path = newPath;
-                pathData.currentStep = 0;
-                pathData.framesUntilRecalc = 30;
-            } else {
-                pathData.path.clear();
-                pathData.framesUntilRecalc = 30;
-                continue;
-            }
-        }
-        
-        pathData.framesUntilRecalc--;
-        
-        if (!pathData.isMoving) {
-            if (!pathData.path.empty() && pathData.currentStep < pathData.path.size()) {
-                pathData.startGridX = enemyGridX;
-                pathData.startGridY = enemyGridY;
-                pathData.targetGridX = pathData.path[pathData.currentStep].first;
-                pathData.targetGridY = pathData.path[pathData.currentStep].second;
-                pathData.moveProgress = 0.0f;
-                pathData.isMoving = true;
-                
-                int dx = pathData.targetGridX - pathData.startGridX;
-                int dy = pathData.targetGridY - pathData.startGridY;
-                
-                if (dx > 0) enemy.angle = -90;
-                else if (dx < 0) enemy.angle = 90;
-                else if (dy > 0) enemy.angle = 0;
-                else if (dy < 0) enemy.angle = 180;
-            }
-        }
-        
-        if (pathData.isMoving) {
-            const float MOVE_SPEED = 0.05f;
-            pathData.moveProgress += MOVE_SPEED;
-            
-            if (pathData.moveProgress >= 1.0f) {
-                pathData.moveProgress = 1.0f;
-                pathData.isMoving = false;
-                pathData.currentStep++;
-                
-                enemy.x = pathData.targetGridX * TILE_SIZE;
-                enemy.y = pathData.targetGridY * TILE_SIZE;
-                
-                if (pathData.currentStep >= pathData.path.size()) {
-                    pathData.framesUntilRecalc = 0;
-                }
-            } else {
-                float startX = pathData.startGridX * TILE_SIZE;
-                float startY = pathData.startGridY * TILE_SIZE;
-                float targetX = pathData.targetGridX * TILE_SIZE;
-                float targetY = pathData.targetGridY * TILE_SIZE;
-                
-                enemy.x = startX + (targetX - startX) * pathData.moveProgress;
-                enemy.y = startY + (targetY - startY) * pathData.moveProgress;
-            }
-        }
-    }
+// A hitch is a frame that took more than twice the median
+void FramePacing::report() {
+    if (intervalsMs.empty()) return;
+
+    vector<float> sorted = intervalsMs;
+    std::sort(sorted.begin(), sorted.end());
+    float sum = 0;
+    for (float ms : sorted) sum += ms;
+    float median = sorted[sorted.size() / 2];
+    float p99 = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+    int hitches = 0;
+    for (float ms : sorted)
+        if (ms > 2 * median) hitches++;
+
+    printf("Frames: %zu, avg %.2f ms, p99 %.2f ms, max %.2f ms, %d hitches (vsync %s)\n",
+           sorted.size(), sum / sorted.size(), p99, sorted.back(), hitches, vsync ? "on" : "off");
+    if (ticks > 0)
+        printf("Ticks: %lld, %.2f heap allocs/tick, %lld with none, arena %zu KB (peak %zu KB)\n",
+               ticks, (double)tickAllocs / ticks, allocFreeTicks,
+               world.frameArena.capacity() / 1024, world.frameArena.highWater() / 1024);
+    intervalsMs.clear();
+    ticks = tickAllocs = allocFreeTicks = 0;
 }
 
 // ============================================================================
-// UPDATE LOOP
+// INPUT
 // ============================================================================
 
-void update(int) {
-    float dx = 0, dy = 0;
-    float pushDirX = 0, pushDirY = 0;
-    bool isPushing = false;
-    
-    if (keys['w']||keys['W']) { dy -= PLAYER_SPEED; pushDirY = -1; isPushing = true; }
-    if (keys['s']||keys['S']) { dy += PLAYER_SPEED; pushDirY = 1; isPushing = true; }
-    if (keys['a']||keys['A']) { dx -= PLAYER_SPEED; pushDirX = -1; isPushing = true; }
-    if (keys['d']||keys['D']) { dx += PLAYER_SPEED; pushDirX = 1; isPushing = true; }
-
-    const float COLLISION_HEIGHT = TILE_SIZE/4.0f;
-    const float COLLISION_TOP_OFFSET = TILE_SIZE - COLLISION_HEIGHT;
-    const float INSET = 1.0f;
-
-    float nextX = player.x + dx;
-    bool blockX = false;
-
-    if (checkCollision(nextX+INSET, player.y+COLLISION_TOP_OFFSET)) blockX = true;
-    if (checkCollision(nextX+INSET, player.y+TILE_SIZE-INSET)) blockX = true;
-    if (checkCollision(nextX+TILE_SIZE-INSET, player.y+COLLISION_TOP_OFFSET)) blockX = true;
-    if (checkCollision(nextX+TILE_SIZE-INSET, player.y+TILE_SIZE-INSET)) blockX = true;
-
-    if (blockX && pushDirX != 0 && isPushing) {
-        startPushingPebble(player.x, player.y, pushDirX, 0);
-    }
-
-    if (!blockX) player.x = nextX;
-
-    float nextY = player.y + dy;
-    bool blockY = false;
-
-    if (checkCollision(player.x+INSET, nextY+COLLISION_TOP_OFFSET)) blockY = true;
-    if (checkCollision(player.x+TILE_SIZE-INSET, nextY+COLLISION_TOP_OFFSET)) blockY = true;
-    if (checkCollision(player.x+INSET, nextY+TILE_SIZE-INSET)) blockY = true;
-    if (checkCollision(player.x+TILE_SIZE-INSET, nextY+TILE_SIZE-INSET)) blockY = true;
-
-    if (blockY && pushDirY != 0 && isPushing) {
-        startPushingPebble(player.x, player.y, 0, pushDirY);
-    }
-
-    if (!blockY) player.y = nextY;
-
-    // Stop pushing if not blocked or not pressing keys
-    if (!isPushing || (!blockX && !blockY)) {
-        stopPushingPebbles();
-    }
-
-    updatePebbles();
-    updateEnemies();
-    checkPortalCollision();
-    checkItemPickup();
-    checkEnemyCollision();
-    checkEnemyFire();
-    
-    glutPostRedisplay();
-    glutTimerFunc(16, update, 0);
+// Editor brushes go to the level definition; the level is then rebuilt
+// so the change shows (and plays) immediately
+void editCell(int gx, int gy) {
+    std::string error;
+    if (editor.apply(world.currLevel, world.placeMode, gx, gy, error))
+        world.reloadLevel();
+    else if (!error.empty())
+        printf("Edit refused: %s\n", error.c_str());
 }
 
-// ============================================================================
-// FIRE / BURN LOGIC
-// ============================================================================
-
-void checkAndPropagateBurn(int gx, int gy) {
-    int nbr[8][2] = {
-        {gx, gy-1}, {gx, gy+1}, {gx-1, gy}, {gx+1, gy},
-        {gx-1, gy-1}, {gx-1, gy+1}, {gx+1, gy-1}, {gx+1, gy+1}
-    };
-
-    for (int i=0;i<8;i++) {
-        int nx = nbr[i][0];
-        int ny = nbr[i][1];
-
-        if (nx<0||nx>=COLS||ny<0||ny>=ROWS) continue;
-
-        for (auto& s : items) {
-            if ((int)(s.x/TILE_SIZE) == nx &&
-                (int)(s.y/TILE_SIZE) == ny &&
-                s.tex == &itemTex)
-            {
-                s.tex = &flameTex;
-                fires.push_back({nx,ny});
-                s.burnEndTime = getCurrentTimeMillis() + 500;
-                printf("Fire spread to [%d,%d]\n", nx, ny);
-                break;
-            }
-        }
-    }
-}
+int lastEditX = -1, lastEditY = -1;
 
-void burnTimerFunc(int) {
-    long long now = getCurrentTimeMillis();
-    bool redraw = false;
+void mouse(int button, int state, int x, int y) {
+    // Tools are not part of the input a network game exchanges
+    if (button != GLUT_LEFT_BUTTON || state != GLUT_DOWN || netplay)
+        return;
 
-    for (auto it = items.begin(); it != items.end();) {
-        if (it->tex == &flameTex && now >= it->burnEndTime) {
-            int gx = it->x / TILE_SIZE;
-            int gy = it->y / TILE_SIZE;
-            fires = {};
-            spreadQueue.push_back({gx, gy});
-            occupiedPositions.erase({gx, gy});
+    int gx = x/TILE_SIZE;
+    int gy = y/TILE_SIZE;
 
-            it = items.erase(it);
-            redraw = true;
-        }
-        else {
-            ++it;
-        }
+    if (editor.active && world.placeMode >= EDIT_WALL) {
+        editCell(gx, gy);
+        lastEditX = gx;
+        lastEditY = gy;
+        return;
     }
 
-    for (auto& e : spreadQueue)
-        checkAndPropagateBurn(e.gridX, e.gridY);
-
-    spreadQueue.clear();
-
-    if (redraw) glutPostRedisplay();
-
-    glutTimerFunc(50, burnTimerFunc, 1);
+    recorder.action(world.placeMode, gx, gy);
+    world.useTool(gx, gy);
 }
 
-// ============================================================================
-// INPUT
-// ============================================================================
-
-void mouse(int button, int state, int x, int y) {
-    if (button != GLUT_LEFT_BUTTON || state != GLUT_DOWN)
+// Dragging paints walls / floor cell by cell
+void motion(int x, int y) {
+    if (!editor.active || (world.placeMode != EDIT_WALL && world.placeMode != EDIT_FLOOR))
         return;
 
     int gx = x/TILE_SIZE;
     int gy = y/TILE_SIZE;
-
-    if (placeMode == 1 && bagCount > 0) {
-        if (gx>=0&&gx<COLS&&gy>=0&&gy<ROWS) {
-            if (levelTiles[gy][gx] == 0) {
-                if (!occupiedPositions.count({gx,gy})) {
-                    Sprite s;
-                    s.x = gx*TILE_SIZE;
-                    s.y = gy*TILE_SIZE;
-                    s.tex = &itemTex;
-                    items.push_back(s);
-
-                    occupiedPositions.insert({gx,gy});
-                    bagCount--;
-                }
-            }
-            else {
-                printf("Cannot place item on wall.\n");
-            }
-        }
-    }
-
-    else if (placeMode == 2) {
-        for (auto& s : items) {
-            if ((int)(s.x/TILE_SIZE)==gx &&
-                (int)(s.y/TILE_SIZE)==gy &&
-                s.tex == &itemTex)
-            {
-                s.tex = &flameTex;
-                fires.push_back({gx,gy});
-                s.burnEndTime = getCurrentTimeMillis() + 500;
-                break;
-            }
-        }
-    }
+    if (gx == lastEditX && gy == lastEditY) return;
+    lastEditX = gx;
+    lastEditY = gy;
+    editCell(gx, gy);
 }
 
 void keyboard(unsigned char key,int,int) {
@@ -878,16 +347,76 @@ void keyboard(unsigned char key,int,int) {
 
     switch(key) {
         case '1':
-            placeMode = 1;
+            world.placeMode = 1;
             break;
         case '2':
-            placeMode = 2;
+            world.placeMode = 2;
             break;
         case 'c': case 'C':
-            items.clear();
-            occupiedPositions.clear();
+            if (netplay) break;
+            recorder.action(REPLAY_CLEAR_ITEMS, 0, 0);
+            world.clearItems();
+            break;
+        case 'l': case 'L':
+            // Both sides of a network game have to chase the same way
+            if (netplay) break;
+            stopRecording("chase mode changed");
+            world.chaseMode = world.chaseMode == CHASE_PLAYER ? CHASE_INTERCEPT : CHASE_PLAYER;
+            printf("Enemies %s\n", world.chaseMode == CHASE_INTERCEPT ? "intercept" : "chase");
+            break;
+        case 'f': case 'F':
+            if (netplay) break;
+            stopRecording("line of sight changed");
+            world.lineOfSight = !world.lineOfSight;
+            printf("Line of sight %s\n", world.lineOfSight ? "on" : "off");
+            glutPostRedisplay();
+            break;
+        case 'n': case 'N':
+            if (netplay) break;
+            stopRecording("next-hop tables changed");
+            world.nextHopTables = !world.nextHopTables;
+            printf("Next-hop tables %s\n", world.nextHopTables ? "on" : "off");
+            break;
+        case 'i': case 'I':
+            useInstancing = !useInstancing;
+            printf("Instanced enemies %s\n", useInstancing && enemySprites.ready() ? "on" : "off");
+            glutPostRedisplay();
+            break;
+        case 'v': case 'V':
+            vsync = !vsync && setSwapInterval(1);
+            if (!vsync) setSwapInterval(0);
+            printf("Vsync %s\n", vsync ? "on" : "off");
+            break;
+        case 'p': case 'P':
+            if (netplay) break;
+            if (gameClock.paused()) gameClock.resume();
+            else gameClock.pause();
+            printf("%s\n", gameClock.paused() ? "Paused" : "Running");
             break;
-        case 27: exit(0);
+        case '-': case '=':
+            if (netplay) break;
+            gameClock.setScale(std::max(0.25, std::min(4.0,
+                key == '=' ? gameClock.scale() * 2 : gameClock.scale() / 2)));
+            printf("Game speed x%.2f\n", gameClock.scale());
+            break;
+        case 'e': case 'E':
+            if (netplay) break;
+            editor.active = !editor.active;
+            if (editor.active) stopRecording("editor opened");
+            world.placeMode = editor.active ? EDIT_WALL : 1;
+            printf("Editor %s\n", editor.active ? "on" : "off");
+            break;
+        case '3': case '4': case '5': case '6': case '7': case '8':
+            if (editor.active) world.placeMode = key - '0';   // EDIT_WALL..EDIT_ERASE
+            break;
+        case 27:
+            stopRecording("quit");
+            if (netplay) {
+                NetplayStats s = netSession.stats();
+                printf("Netplay: %d ticks, %d rollbacks (%d ticks replayed), %d stalls, %lld bytes sent\n",
+                       s.ticks, s.rollbacks, s.replayedTicks, s.stalls, s.bytesSent);
+            }
+            exit(0);
     }
 }
 
@@ -899,75 +428,168 @@ void keyboardUp(unsigned char key,int,int) {
 // RENDERING
 // ============================================================================
 
-void display() {
+// Fills drawCmds back to front: tiles, portals, berries, items, pebbles,
+// enemies, player (and partner). Every layer writes its own slice, so the layers (and
+// the tile rows) are generated as independent jobs. The tiles sit at the
+// front at a fixed size and are left as they are until mapVersion moves.
+void buildDrawCommands() {
+    const size_t nTiles   = ROWS * COLS;
+    const size_t oPortals = nTiles;
+    const size_t oBerries = oPortals + world.portals.size();
+    const size_t oItems   = oBerries + world.berries.size();
+    const size_t oPebbles = oItems + world.items.size();
+    const size_t oEnemies = oPebbles + world.pebbles.size();
+    const size_t oPlayer  = oEnemies + world.enemies.size();
+    drawCmds.resize(oPlayer + (world.hasPartner ? 2 : 1));
+    drawLayout = {oItems, oPebbles, oEnemies, oPlayer};
+
+    DrawCmd* out = drawCmds.data();
+
+    JobHandle tiles;
+    if (!tilesBuilt || tilesBuiltVersion != world.mapVersion) {
+        tilesBuilt = true;
+        tilesBuiltVersion = world.mapVersion;
+        tiles = jobs.addBatch(ROWS, 6, [out](int r) {
+            for (int c=0;c<COLS;c++) {
+                float px = c*TILE_SIZE;
+                float py = r*TILE_SIZE;
+                GLuint tex = world.levelTiles[r][c] == 1 ? wallTex.id : floorTex.id;
+                out[r*COLS + c] = {px, py, tex, false, 0};
+            }
+        });
+    }
+
+    JobHandle fixed = jobs.add([=] {
+        DrawCmd* o = out + oPortals;
+        for (auto& p : world.portals)
+            *o++ = {(float)p.gridX*TILE_SIZE, (float)p.gridY*TILE_SIZE, holeTex.id, false, 0};
+        for (auto& p : world.berries)
+            *o++ = {(float)p.gridX*TILE_SIZE, (float)p.gridY*TILE_SIZE, berryTex.id, false, 0};
+    });
+
+    JobHandle dynamic = jobs.add([=] {
+        DrawCmd* o = out + oItems;
+        for (auto& s : world.items)
+            *o++ = {s.x, s.y, s.tex->id, false, 0};
+        for (auto& p : world.pebbles)
+            *o++ = {p.x, p.y, pebbleTex.id, false, 0};
+        for (auto& e : world.enemies)
+            *o++ = {e.x, e.y, e.tex->id, true, e.angle};
+        out[oPlayer] = {world.player.x, world.player.y, world.player.tex->id, false, 0};
+        if (world.hasPartner)
+            out[oPlayer + 1] = {world.partner.x, world.partner.y, world.partner.tex->id, false, 0};
+    });
+
+    jobs.wait(jobs.add([] {}, {tiles, fixed, dynamic}));
+}
+
+HudState currentHud() {
+    uint32_t changed = world.inventory.takeChanges();
+    if (!hudItemsSynced) {
+        changed = ~0u;
+        hudItemsSynced = true;
+    }
+    for (int i = 0; i < NUM_ITEM_TYPES; i++)
+        if (changed & (1u << i)) hud.items[i] = world.inventory.count((ItemId)i);
+
+    hud.level = world.currLevel;
+    hud.placeMode = world.placeMode;
+    return hud;
+}
+
+// Fog of war: every cell the player cannot see is dimmed as one quad, so
+// the cost is per cell and follows the field the enemies look through
+void drawFog(const uint8_t* view) {
+    if (!view) return;
+    glDisable(GL_TEXTURE_2D);
+    glColor4f(0, 0, 0, 0.75f);
+    glBegin(GL_QUADS);
+    for (int r = 0; r < ROWS; r++)
+        for (int c = 0; c < COLS; c++) {
+            if (view[r * COLS + c]) continue;
+            float x = c * TILE_SIZE, y = r * TILE_SIZE;
+            glVertex2f(x, y);
+            glVertex2f(x + TILE_SIZE, y);
+            glVertex2f(x + TILE_SIZE, y + TILE_SIZE);
+            glVertex2f(x, y + TILE_SIZE);
+        }
+    glEnd();
+    glColor4f(1, 1, 1, 1);
+    glEnable(GL_TEXTURE_2D);
+}
+
+// Everything display() draws, without the buffer swap. The HUD text goes
+// through GLUT's bitmap font, so headless captures leave it out.
+void renderFrame(bool hud) {
     glClearColor(0.1f,0.1f,0.1f,1);
     glClear(GL_COLOR_BUFFER_BIT);
 
     glLoadIdentity();
 
-    // --- draw tiles ---
-    for (int r=0;r<ROWS;r++) {
-        for (int c=0;c<COLS;c++) {
-            float px = c*TILE_SIZE;
-            float py = r*TILE_SIZE;
+    size_t enemiesBegin = frameCmds.size(), enemiesEnd = frameCmds.size();
+    if (useInstancing && enemySprites.ready() && drawLayout.oPlayer < frameCmds.size()) {
+        enemiesBegin = drawLayout.oEnemies;
+        enemiesEnd = drawLayout.oPlayer;
+    }
 
-            if (levelTiles[r][c] == 1)
-                drawQuad(px,py,TILE_SIZE,TILE_SIZE, wallTex.id);
-            else
-                drawQuad(px,py,TILE_SIZE,TILE_SIZE, floorTex.id);
+    enemyInstances.clear();
+    for (size_t i = enemiesBegin; i < enemiesEnd; i++) {
+        const DrawCmd& cmd = frameCmds[i];
+        int layer = enemySprites.layerOf(cmd.tex);
+        if (layer < 0) {
+            // A sprite the array does not hold: the whole layer goes the old way
+            enemiesBegin = enemiesEnd = frameCmds.size();
+            break;
         }
+        enemyInstances.push_back({cmd.x, cmd.y, cmd.angle, (float)layer});
     }
 
-    // --- draw portals ---
-    for (auto& p : portals) {
-        float px = p.gridX*TILE_SIZE;
-        float py = p.gridY*TILE_SIZE;
-        drawQuad(px, py, TILE_SIZE, TILE_SIZE, holeTex.id);
+    for (size_t i = 0; i < frameCmds.size(); i++) {
+        if (i == enemiesBegin && enemiesBegin < enemiesEnd) {
+            enemySprites.draw(enemyInstances.data(), (int)enemyInstances.size(), TILE_SIZE);
+            i = enemiesEnd - 1;
+            continue;
+        }
+        const DrawCmd& cmd = frameCmds[i];
+        if (cmd.rotated)
+            drawQuadRotated(cmd.x, cmd.y, TILE_SIZE, TILE_SIZE, cmd.tex, cmd.angle);
+        else
+            drawQuad(cmd.x, cmd.y, TILE_SIZE, TILE_SIZE, cmd.tex);
     }
-    
-    // --- draw berries ---
-    for (auto& p : berries) {
-        float px = p.gridX*TILE_SIZE;
-        float py = p.gridY*TILE_SIZE;
-        drawQuad(px, py, TILE_SIZE, TILE_SIZE, berryTex.id);
-    }    
-
-    // --- items ---
-    for (auto& s : items)
-        drawQuad(s.x, s.y, TILE_SIZE, TILE_SIZE, s.tex->id);
-
-    // --- pebbles ---
-    for (auto& p : pebbles)
-        drawQuad(p.x, p.y, TILE_SIZE, TILE_SIZE, pebbleTex.id);
 
-    // --- enemies ---
-    for (auto& e : enemies)
-        drawQuadRotated(e.x, e.y, TILE_SIZE, TILE_SIZE, e.tex->id, e.angle);
+    if (world.lineOfSight) drawFog(world.viewFrom(world.player));
 
-    // --- player ---
-    drawQuad(player.x, player.y, TILE_SIZE, TILE_SIZE, player.tex->id);
+    if (!hud) return;
 
     // --- UI ---
     glDisable(GL_TEXTURE_2D);
     char buf1[64];
-    sprintf(buf1, "Level: %d/%d", currLevel+1, NUM_LEVELS);
+    sprintf(buf1, "Level: %d/%d", world.currLevel+1, NUM_LEVELS);
     renderText(10,20,buf1);
 
     char buf2[64];
-    sprintf(buf2, "Bags: %d", bagCount);
+    sprintf(buf2, "Bags: %d", shownHud.items[ITEM_BAG]);
     renderText(10,40,buf2);
 
     char buf3[64];
-    sprintf(buf3, "Mode: %s", (placeMode==1 ? "Place" : "Burn"));
+    sprintf(buf3, "Mode: %s", brushName(world.placeMode));
     renderText(10,60,buf3);
     
     char buf4[64];
-    sprintf(buf4, "Berries: %d", inventory["berry"]);
+    sprintf(buf4, "Berries: %d", shownHud.items[ITEM_BERRY]);
     renderText(10,80,buf4);
     
     glEnable(GL_TEXTURE_2D);
+}
+
+void display() {
+    shownCmds = frameCmds;
+    shownHud = currentHud();
+
+    renderFrame(true);
 
     glutSwapBuffers();
+    pacing.presented(getCurrentTimeMicros());
 }
 
 void reshape(int w,int h) {
@@ -982,7 +604,7 @@ void reshape(int w,int h) {
 // INIT + MAIN
 // ============================================================================
 
-void init() {
+void initGraphics() {
     glEnable(GL_TEXTURE_2D);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -998,27 +620,300 @@ void init() {
     deadantTex = loadTexture("deadant.png");
     pebbleTex = loadTexture("pebble.png");
 
-    player.tex = &playerTex;
+    const Texture* enemyTextures[] = {&antTex, &deadantTex};
+    if (!enemySprites.init(enemyTextures, 2, antTex.w))
+        printf("Instanced sprites unavailable, drawing enemies one by one\n");
+}
+
+void initWorld(int level) {
+    editor.loadAll();
+    world.levels = editor.levels;
+
+    world.loadLevel(level);
+    buildDrawCommands();
+    frameCmds = drawCmds;
+}
+
+void init(int level) {
+    initGraphics();
 
-    loadLevel(0);
+    // Enemy searches get at most 1 ms of each 16 ms frame; on A* / JPS
+    // levels they run on the path thread instead. A recording has to
+    // replay exactly, so it keeps to the step budget, as does a network
+    // game, where both sides must simulate the same thing.
+    if (recordPath.empty() && !netplay) {
+        world.pathBudget.maxMicros = 1000;
+        world.pathWorker = &pathWorker;
+    }
+
+    world.hasPartner = netplay;
+    initWorld(level);
+    if (!recordPath.empty()) {
+        recorder.start(world, (int)SIM_TICK_MS);
+        printf("Recording to %s\n", recordPath.c_str());
+    }
+
+    // Presentation waits on the display refresh where the driver allows
+    vsync = setSwapInterval(1);
+    printf("Vsync %s\n", vsync ? "on" : "unavailable, frames capped at 120/s");
+
+    gameClock.reset();
+    simClockMs = 0;
+    lastIdleNs = 0;
+}
+
+// Headless run for CI: `game --capture <frames> <outdir> [refdir] [level]`.
+// Plays `frames` ticks with no input, renders each one offscreen, writes
+// <outdir>/frameNNNN.png and reports how long rendering took. With a
+// reference directory, each frame is also compared against the PNG of the
+// same name there and any difference fails the run.
+//
+// Everything that could make two runs differ is pinned: the clock starts
+// at 0, path searches run in-step with a step budget only, and frames are
+// the latest tick rather than a blend.
+int runCapture(int frames, const string& outDir, const char* refDir, int level) {
+    OffscreenTarget target;
+    std::string error;
+    if (!target.create(WIN_W, WIN_H, error)) {
+        printf("Capture failed: %s\n", error.c_str());
+        return 1;
+    }
+    printf("Rendering offscreen on %s\n", target.renderer());
+    reshape(WIN_W, WIN_H);
+    initGraphics();
+
+    world.pathBudget.maxMicros = 0;
+    initWorld(level);
+
+    std::error_code ec;
+    std::filesystem::create_directories(outDir, ec);
+
+    vector<float> renderMs;
+    vector<uint8_t> pixels;
+    int mismatched = 0;
+    simClockMs = 0;
+
+    for (int f = 0; f < frames; f++) {
+        tick();
+        frameCmds = drawCmds;
+
+        long long start = getCurrentTimeMicros();
+        renderFrame(false);
+        glFinish();
+        renderMs.push_back((getCurrentTimeMicros() - start) / 1000.0f);
+
+        target.readPixels(pixels);
+        char name[32];
+        snprintf(name, sizeof(name), "frame%04d.png", f);
+        if (!writePNG(outDir + "/" + name, pixels.data(), WIN_W, WIN_H)) {
+            printf("Cannot write %s/%s\n", outDir.c_str(), name);
+            return 1;
+        }
+
+        if (refDir) {
+            long diff = comparePNG(string(refDir) + "/" + name, pixels.data(), WIN_W, WIN_H);
+            if (diff != 0) {
+                mismatched++;
+                if (diff < 0) printf("%s: no usable reference\n", name);
+                else printf("%s: %ld pixels differ\n", name, diff);
+            }
+        }
+    }
+
+    vector<float> sorted = renderMs;
+    std::sort(sorted.begin(), sorted.end());
+    float sum = 0;
+    for (float ms : sorted) sum += ms;
+    if (!sorted.empty())
+        printf("Rendered %zu frames: avg %.3f ms, median %.3f ms, p99 %.3f ms, max %.3f ms\n",
+               sorted.size(), sum / sorted.size(), sorted[sorted.size() / 2],
+               sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)], sorted.back());
+    if (refDir)
+        printf("%d of %d frames differ from %s\n", mismatched, frames, refDir);
+    return mismatched ? 1 : 0;
+}
+
+// `game --replay <file> [out]`: plays a recording headless and checks
+// every tick against the recorded state hashes. Run by another build, it
+// reports the first tick and part of the state that came out different.
+// With `out`, the hashes this build produced are written there too.
+int runReplay(const char* path, const char* outPath) {
+    ReplayLog log;
+    std::string error;
+    if (!log.load(path, error)) {
+        printf("Cannot read %s: %s\n", path, error.c_str());
+        return 1;
+    }
+
+    editor.loadAll();
+    world.levels = editor.levels;
+    world.verbose = false;
+    if (hashLevels(world.levels, NUM_LEVELS) != log.levelsHash) {
+        printf("%s was recorded against different level files\n", path);
+        return 1;
+    }
+
+    ReplayLog rerecorded;
+    ReplayResult r = replay(world, log, outPath ? &rerecorded : nullptr);
+    if (outPath && !rerecorded.save(outPath))
+        printf("Cannot write %s\n", outPath);
+
+    if (r.divergedTick < 0) {
+        printf("%d ticks replayed, all match\n", r.ticks);
+        return 0;
+    }
+    printf("Diverged at tick %d in %s\n", r.divergedTick, hashFieldName(r.divergedField));
+    for (int i = 0; i < NUM_HASH_FIELDS; i++)
+        printf("  %-8s recorded %016llx  replayed %016llx%s\n", hashFieldName(i),
+               (unsigned long long)r.expected.fields[i], (unsigned long long)r.actual.fields[i],
+               r.expected.fields[i] != r.actual.fields[i] ? "  <--" : "");
+    return 1;
+}
+
+// `game --net-loopback <ticks> [latencyMs] [loss%] [delay]`: two network
+// sessions on this machine, each with its own world and random held input,
+// over localhost with the given one-way latency and packet loss. Once both
+// have confirmed every tick, their worlds must hash the same.
+int runNetLoopback(int ticks, int latencyMs, float lossPercent, int delay) {
+    editor.loadAll();
+
+    World worlds[2];
+    LockstepSession sessions[2];
+    FakeTime netTime;
+    NetConditions conditions;
+    conditions.latencyMs = latencyMs;
+    conditions.jitterMs = latencyMs / 4;
+    conditions.loss = lossPercent / 100.0f;
+
+    for (int side = 0; side < 2; side++) {
+        World& w = worlds[side];
+        w.levels = editor.levels;
+        w.verbose = false;
+        w.hasPartner = true;
+        w.loadLevel(0);
+
+        NetplayConfig config;
+        config.localPlayer = side;
+        config.inputDelay = delay;
+        config.tickMs = (int)SIM_TICK_MS;
+        std::string error;
+        if (!sessions[side].start(w, config, 47100 + side, "127.0.0.1", 47101 - side, error)) {
+            printf("Cannot start side %d: %s\n", side, error.c_str());
+            return 1;
+        }
+        conditions.seed = side + 1;
+        sessions[side].link().setConditions(conditions, netTime);
+    }
+
+    // Each side holds a random direction for a while, like a player would
+    std::mt19937 rng(7);
+    uint8_t held[2] = {0, 0};
+    const uint8_t moves[] = {0, INPUT_UP, INPUT_DOWN, INPUT_LEFT, INPUT_RIGHT,
+                             INPUT_UP | INPUT_LEFT, INPUT_DOWN | INPUT_RIGHT};
+
+    long long start = getCurrentTimeMicros();
+    for (int frame = 0; ; frame++) {
+        bool done = true;
+        for (int side = 0; side < 2; side++) {
+            LockstepSession& s = sessions[side];
+            if (s.tick() < ticks) {
+                if (rng() % 20 == 0) held[side] = moves[rng() % (sizeof(moves) / sizeof(moves[0]))];
+                s.advance(worlds[side], held[side]);
+            } else {
+                s.sync(worlds[side]);
+            }
+            if (s.stats().confirmedTicks < ticks) done = false;
+        }
+        if (done) break;
+
+        netTime.advance(SIM_TICK_NS);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        if (frame > ticks * 50) {
+            printf("Gave up waiting for the sessions to confirm %d ticks\n", ticks);
+            return 1;
+        }
+    }
+    long long elapsedUs = getCurrentTimeMicros() - start;
+
+    for (int side = 0; side < 2; side++) {
+        NetplayStats s = sessions[side].stats();
+        printf("Side %d: %d ticks, %d rollbacks, %d ticks replayed, %d stalls, %.1f bytes/tick\n",
+               side, s.ticks, s.rollbacks, s.replayedTicks, s.stalls, (double)s.bytesSent / s.ticks);
+    }
+    printf("%.1f ms for %d ticks per side\n", elapsedUs / 1000.0, ticks);
+
+    StateHash a = hashState(worlds[0]), b = hashState(worlds[1]);
+    int field = a.firstDifference(b);
+    if (field < 0) {
+        printf("Both sides agree after %d ticks\n", ticks);
+        return 0;
+    }
+    printf("Sides differ in %s\n", hashFieldName(field));
+    return 1;
 }
 
 int main(int argc,char** argv) {
+    if (argc >= 4 && string(argv[1]) == "--capture") {
+        const char* refDir = argc >= 5 ? argv[4] : nullptr;
+        int level = argc >= 6 ? atoi(argv[5]) : 0;
+        if (level < 0 || level >= NUM_LEVELS) level = 0;
+        return runCapture(atoi(argv[2]), argv[3], refDir, level);
+    }
+    if (argc >= 3 && string(argv[1]) == "--replay")
+        return runReplay(argv[2], argc >= 4 ? argv[3] : nullptr);
+
+    if (argc >= 3 && string(argv[1]) == "--net-loopback")
+        return runNetLoopback(atoi(argv[2]), argc >= 4 ? atoi(argv[3]) : 50,
+                              argc >= 5 ? (float)atof(argv[4]) : 5, argc >= 6 ? atoi(argv[5]) : 2);
+
+    // `game --record <file> [level]`
+    int startLevel = 0;
+    if (argc >= 3 && string(argv[1]) == "--record") {
+        recordPath = argv[2];
+        startLevel = argc >= 4 ? atoi(argv[3]) : 0;
+        if (startLevel < 0 || startLevel >= NUM_LEVELS) startLevel = 0;
+    }
+
+    // `game --net <player 0|1> <localPort> <peerHost> <peerPort> [delay]`,
+    // started on both machines with the same level files. Player 0 is the
+    // usual player and leads through portals; player 1 is the partner.
+    NetplayConfig netConfig;
+    int netLocalPort = 0, netPeerPort = 0;
+    string netPeerHost;
+    if (argc >= 6 && string(argv[1]) == "--net") {
+        netplay = true;
+        netConfig.localPlayer = atoi(argv[2]) == 1 ? 1 : 0;
+        netLocalPort = atoi(argv[3]);
+        netPeerHost = argv[4];
+        netPeerPort = atoi(argv[5]);
+        if (argc >= 7) netConfig.inputDelay = atoi(argv[6]);
+        netConfig.tickMs = (int)SIM_TICK_MS;
+    }
+
     glutInit(&argc,argv);
     glutInitDisplayMode(GLUT_DOUBLE|GLUT_RGBA);
     glutInitWindowSize(WIN_W,WIN_H);
     glutCreateWindow("Portal-Level Game — With Pebbles!");
 
-    init();
+    init(startLevel);
+    if (netplay) {
+        std::string error;
+        if (!netSession.start(world, netConfig, netLocalPort, netPeerHost, netPeerPort, error)) {
+            printf("Cannot start network game: %s\n", error.c_str());
+            return 1;
+        }
+        printf("Network game as player %d, input delay %d ticks\n",
+               netConfig.localPlayer, netConfig.inputDelay);
+    }
 
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     glutKeyboardFunc(keyboard);
     glutKeyboardUpFunc(keyboardUp);
     glutMouseFunc(mouse);
+    glutMotionFunc(motion);
 
-    glutTimerFunc(0, update, 0);
-    glutTimerFunc(50, burnTimerFunc, 1);
+    glutIdleFunc(idle);
 
     glutMainLoop();
     return 0;
@@ -0,0 +1,391 @@
+// ============================================================================
+// hpa.cpp
+// HIERARCHICAL PATHFINDING (HPA*) FOR LEVELS LARGER THAN ONE SCREEN
+// ============================================================================
+
+#include "hpa.h"
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+
+static const int INF = 1 << 29;
+static const int DIRS[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+// Entrances at least this long get a node pair at both ends instead of
+// one in the middle, so long openings do not force a detour to the centre
+static const int LONG_ENTRANCE = 6;
+
+HierarchicalPlanner::HierarchicalPlanner(int size)
+    : clusterSize(std::max(2, size)) {}
+
+void HierarchicalPlanner::build(const PathGrid& grid) {
+    width = grid.width;
+    height = grid.height;
+    clustersX = (width + clusterSize - 1) / clusterSize;
+    clustersY = (height + clusterSize - 1) / clusterSize;
+
+    blocked.assign(width * height, 0);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            blocked[cell(x, y)] = !grid.walkable(x, y);
+
+    nodes.clear();
+    freeNodes.clear();
+    clusterNodes.assign(clustersX * clustersY, {});
+    borderNodes.assign(clustersX * clustersY * 2, {});
+    dirty.assign(clustersX * clustersY, 1);
+
+    rebuildDirty();
+}
+
+bool HierarchicalPlanner::isBlocked(int x, int y) const {
+    return !open(x, y);
+}
+
+void HierarchicalPlanner::setBlocked(int x, int y, bool isBlocked) {
+    if (x < 0 || x >= width || y < 0 || y >= height) return;
+    if (blocked[cell(x, y)] == (uint8_t)isBlocked) return;
+    blocked[cell(x, y)] = isBlocked;
+    dirty[clusterOf(x, y)] = 1;
+}
+
+int HierarchicalPlanner::nodeCount() const {
+    return (int)(nodes.size() - freeNodes.size());
+}
+
+void HierarchicalPlanner::clusterBounds(int c, int& x0, int& y0, int& x1, int& y1) const {
+    x0 = (c % clustersX) * clusterSize;
+    y0 = (c / clustersX) * clusterSize;
+    x1 = std::min(x0 + clusterSize, width) - 1;
+    y1 = std::min(y0 + clusterSize, height) - 1;
+}
+
+// ============================================================================
+// GRAPH CONSTRUCTION
+// ============================================================================
+
+int HierarchicalPlanner::addNode(int x, int y, int border) {
+    int id;
+    if (!freeNodes.empty()) {
+        id = freeNodes.back();
+        freeNodes.pop_back();
+    } else {
+        id = (int)nodes.size();
+        nodes.emplace_back();
+    }
+
+    Node& n = nodes[id];
+    n.x = x;
+    n.y = y;
+    n.cluster = clusterOf(x, y);
+    n.border = border;
+    n.alive = true;
+    n.edges.clear();
+
+    clusterNodes[n.cluster].push_back(id);
+    borderNodes[border].push_back(id);
+    return id;
+}
+
+void HierarchicalPlanner::removeBorderNodes(int border) {
+    for (int id : borderNodes[border]) {
+        Node& n = nodes[id];
+        auto& list = clusterNodes[n.cluster];
+        list.erase(std::remove(list.begin(), list.end(), id), list.end());
+        n.alive = false;
+        n.edges.clear();
+        freeNodes.push_back(id);
+    }
+    borderNodes[border].clear();
+}
+
+void HierarchicalPlanner::buildBorder(int border) {
+    int c = border / 2, dir = border % 2;
+    int cx = c % clustersX, cy = c / clustersX;
+    if (dir == 0 && cx + 1 >= clustersX) return;
+    if (dir == 1 && cy + 1 >= clustersY) return;
+
+    int x0, y0, x1, y1;
+    clusterBounds(c, x0, y0, x1, y1);
+
+    // Walk along the border; (ax,ay) is inside c, (bx,by) across it
+    int length = dir == 0 ? y1 - y0 + 1 : x1 - x0 + 1;
+    auto sideA = [&](int i, int& x, int& y) { x = dir == 0 ? x1 : x0 + i; y = dir == 0 ? y0 + i : y1; };
+
+    auto placePair = [&](int i) {
+        int ax, ay;
+        sideA(i, ax, ay);
+        int bx = ax + (dir == 0), by = ay + (dir == 1);
+        int a = addNode(ax, ay, border);
+        int b = addNode(bx, by, border);
+        nodes[a].edges.push_back({b, 1});
+        nodes[b].edges.push_back({a, 1});
+    };
+
+    int runStart = -1;
+    for (int i = 0; i <= length; i++) {
+        bool passable = false;
+        if (i < length) {
+            int ax, ay;
+            sideA(i, ax, ay);
+            passable = open(ax, ay) && open(ax + (dir == 0), ay + (dir == 1));
+        }
+
+        if (passable && runStart < 0) runStart = i;
+        if (!passable && runStart >= 0) {
+            int runEnd = i - 1;
+            if (runEnd - runStart + 1 >= LONG_ENTRANCE) {
+                placePair(runStart);
+                placePair(runEnd);
+            } else {
+                placePair((runStart + runEnd) / 2);
+            }
+            runStart = -1;
+        }
+    }
+}
+
+void HierarchicalPlanner::buildClusterEdges(int c) {
+    const auto& members = clusterNodes[c];
+
+    int x0, y0, x1, y1;
+    clusterBounds(c, x0, y0, x1, y1);
+    int lw = x1 - x0 + 1;
+
+    std::vector<int> dist;
+    for (int id : members) {
+        clusterSearch(c, nodes[id].x, nodes[id].y, dist, nullptr);
+        for (int other : members) {
+            if (other == id) continue;
+            int d = dist[(nodes[other].y - y0) * lw + (nodes[other].x - x0)];
+            if (d >= 0) nodes[id].edges.push_back({other, d});
+        }
+    }
+}
+
+int HierarchicalPlanner::rebuildDirty() {
+    const int numClusters = clustersX * clustersY;
+    std::vector<uint8_t> borderTouched(numClusters * 2, 0);
+    std::vector<uint8_t> clusterTouched(numClusters, 0);
+
+    for (int c = 0; c < numClusters; c++) {
+        if (!dirty[c]) continue;
+        int cx = c % clustersX, cy = c / clustersX;
+        borderTouched[borderIndex(c, 0)] = 1;
+        borderTouched[borderIndex(c, 1)] = 1;
+        if (cx > 0) borderTouched[borderIndex(c - 1, 0)] = 1;
+        if (cy > 0) borderTouched[borderIndex(c - clustersX, 1)] = 1;
+    }
+
+    for (int b = 0; b < numClusters * 2; b++) {
+        if (!borderTouched[b]) continue;
+        int c = b / 2;
+        clusterTouched[c] = 1;
+        if (b % 2 == 0 && c % clustersX + 1 < clustersX) clusterTouched[c + 1] = 1;
+        if (b % 2 == 1 && c + clustersX < numClusters) clusterTouched[c + clustersX] = 1;
+    }
+
+    // Drop in-cluster edges while node ids still mean what they did;
+    // removed nodes are recycled below, possibly into other clusters
+    for (int c = 0; c < numClusters; c++) {
+        if (!clusterTouched[c]) continue;
+        for (int id : clusterNodes[c]) {
+            auto& edges = nodes[id].edges;
+            edges.erase(std::remove_if(edges.begin(), edges.end(),
+                                       [&](const Edge& e) { return nodes[e.to].cluster == c; }),
+                        edges.end());
+        }
+    }
+
+    for (int b = 0; b < numClusters * 2; b++) {
+        if (!borderTouched[b]) continue;
+        removeBorderNodes(b);
+        buildBorder(b);
+    }
+
+    int rebuilt = 0;
+    for (int c = 0; c < numClusters; c++) {
+        if (!clusterTouched[c]) continue;
+        buildClusterEdges(c);
+        rebuilt++;
+    }
+
+    std::fill(dirty.begin(), dirty.end(), 0);
+    return rebuilt;
+}
+
+// ============================================================================
+// QUERIES
+// ============================================================================
+
+int HierarchicalPlanner::clusterSearch(int c, int fromX, int fromY, std::vector<int>& dist,
+                                       std::vector<int>* parent, int stopX, int stopY) const
+{
+    int x0, y0, x1, y1;
+    clusterBounds(c, x0, y0, x1, y1);
+    int lw = x1 - x0 + 1, lh = y1 - y0 + 1;
+
+    dist.assign(lw * lh, -1);
+    if (parent) parent->assign(lw * lh, -1);
+
+    std::vector<int> queue;
+    queue.reserve(lw * lh);
+    int start = (fromY - y0) * lw + (fromX - x0);
+    dist[start] = 0;
+    queue.push_back(start);
+
+    // The start may be blocked (an ant under a pebble); it can still leave
+    for (size_t head = 0; head < queue.size(); head++) {
+        int cur = queue[head];
+        int x = x0 + cur % lw, y = y0 + cur / lw;
+        if (x == stopX && y == stopY) break;
+
+        for (auto& d : DIRS) {
+            int nx = x + d[0], ny = y + d[1];
+            if (nx < x0 || nx > x1 || ny < y0 || ny > y1 || !open(nx, ny)) continue;
+            int li = (ny - y0) * lw + (nx - x0);
+            if (dist[li] >= 0) continue;
+            dist[li] = dist[cur] + 1;
+            if (parent) (*parent)[li] = cur;
+            queue.push_back(li);
+        }
+    }
+    return (int)queue.size();
+}
+
+bool HierarchicalPlanner::refine(int fromX, int fromY, int toX, int toY,
+                                 GridPath& out, HpaStats* stats) const
+{
+    if (fromX == toX && fromY == toY) return true;
+
+    int c = clusterOf(fromX, fromY);
+    if (clusterOf(toX, toY) != c) {
+        // Border crossing between the two nodes of an entrance
+        out.push_back({toX, toY});
+        return true;
+    }
+
+    int x0, y0, x1, y1;
+    clusterBounds(c, x0, y0, x1, y1);
+    int lw = x1 - x0 + 1;
+
+    std::vector<int> dist, parent;
+    int visits = clusterSearch(c, fromX, fromY, dist, &parent, toX, toY);
+    if (stats) stats->refineVisits += visits;
+
+    int target = (toY - y0) * lw + (toX - x0);
+    if (dist[target] < 0) return false;
+
+    size_t mark = out.size();
+    for (int cur = target; parent[cur] >= 0; cur = parent[cur])
+        out.push_back({x0 + cur % lw, y0 + cur / lw});
+    std::reverse(out.begin() + mark, out.end());
+    return true;
+}
+
+bool HierarchicalPlanner::findPath(int startX, int startY, int goalX, int goalY,
+                                   GridPath& outPath, HpaStats* stats) const
+{
+    outPath.clear();
+
+    if (startX == goalX && startY == goalY) return false;
+    if (startX < 0 || startX >= width || startY < 0 || startY >= height) return false;
+    if (!open(goalX, goalY)) return false;
+
+    int sc = clusterOf(startX, startY);
+    int gc = clusterOf(goalX, goalY);
+
+    // Same cluster: a local search usually settles it without the graph
+    if (sc == gc && refine(startX, startY, goalX, goalY, outPath, stats))
+        return true;
+    outPath.clear();
+
+    // Link start and goal to the nodes of their clusters
+    std::vector<int> startDist, goalDist;
+    int sx0, sy0, sx1, sy1, gx0, gy0, gx1, gy1;
+    clusterBounds(sc, sx0, sy0, sx1, sy1);
+    clusterBounds(gc, gx0, gy0, gx1, gy1);
+    int visits = clusterSearch(sc, startX, startY, startDist, nullptr);
+    visits += clusterSearch(gc, goalX, goalY, goalDist, nullptr);
+    if (stats) stats->refineVisits += visits;
+
+    const int N = (int)nodes.size();
+    const int GOAL = N;   // virtual node for the goal cell
+
+    auto toGoal = [&](int id) {
+        const Node& n = nodes[id];
+        if (n.cluster != gc) return -1;
+        return goalDist[(n.y - gy0) * (gx1 - gx0 + 1) + (n.x - gx0)];
+    };
+
+    std::vector<int> g(N + 1, INF), parent(N + 1, -1);
+    std::vector<uint8_t> closed(N + 1, 0);
+    typedef std::pair<int, int> Entry;   // (f, node)
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> openSet;
+
+    auto h = [&](int id) {
+        if (id == GOAL) return 0;
+        return abs(nodes[id].x - goalX) + abs(nodes[id].y - goalY);
+    };
+
+    for (int id : clusterNodes[sc]) {
+        int d = startDist[(nodes[id].y - sy0) * (sx1 - sx0 + 1) + (nodes[id].x - sx0)];
+        if (d < 0 || d >= g[id]) continue;
+        g[id] = d;
+        openSet.push({d + h(id), id});
+    }
+
+    bool found = false;
+    while (!openSet.empty()) {
+        int cur = openSet.top().second;
+        openSet.pop();
+        if (closed[cur]) continue;
+        closed[cur] = 1;
+        if (stats) stats->abstractExpansions++;
+
+        if (cur == GOAL) {
+            found = true;
+            break;
+        }
+
+        int dg = toGoal(cur);
+        if (dg >= 0 && g[cur] + dg < g[GOAL]) {
+            g[GOAL] = g[cur] + dg;
+            parent[GOAL] = cur;
+            openSet.push({g[GOAL], GOAL});
+        }
+
+        for (const Edge& e : nodes[cur].edges) {
+            if (closed[e.to]) continue;
+            int ng = g[cur] + e.cost;
+            if (ng < g[e.to]) {
+                g[e.to] = ng;
+                parent[e.to] = cur;
+                openSet.push({ng + h(e.to), e.to});
+            }
+        }
+    }
+
+    if (!found) return false;
+
+    std::vector<int> chain;
+    for (int id = parent[GOAL]; id >= 0; id = parent[id])
+        chain.push_back(id);
+    std::reverse(chain.begin(), chain.end());
+
+    int cx = startX, cy = startY;
+    for (int id : chain) {
+        if (!refine(cx, cy, nodes[id].x, nodes[id].y, outPath, stats)) {
+            outPath.clear();
+            return false;
+        }
+        cx = nodes[id].x;
+        cy = nodes[id].y;
+    }
+    if (!refine(cx, cy, goalX, goalY, outPath, stats)) {
+        outPath.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,95 @@
+// ============================================================================
+// hpa.h
+// HIERARCHICAL PATHFINDING (HPA*) FOR LEVELS LARGER THAN ONE SCREEN
+// ============================================================================
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "pathfinding.h"
+
+struct HpaStats {
+    int abstractExpansions = 0;   // nodes closed in the entrance graph
+    int refineVisits = 0;         // cells visited by in-cluster searches
+};
+
+// The grid is cut into square clusters. Wherever two neighbouring clusters
+// share a run of open border cells there is an entrance: a pair of nodes,
+// one each side, joined by a step of cost 1. Inside a cluster every pair
+// of its nodes is joined by the in-cluster walking distance.
+//
+// A query links start and goal to the nodes of their own clusters, runs
+// A* over that small graph and then refines each hop with a search
+// bounded to one cluster, so a chase across a big map costs a few dozen
+// graph nodes plus local work, with no MAX_ITERATIONS cap to run into.
+//
+// setBlocked() only marks clusters dirty; rebuildDirty() then redoes the
+// entrances on their borders and the edges of the clusters touching them.
+class HierarchicalPlanner {
+public:
+    explicit HierarchicalPlanner(int clusterSize = 10);
+
+    void build(const PathGrid& grid);
+    bool ready() const { return width > 0; }
+
+    void setBlocked(int x, int y, bool blocked);
+    bool isBlocked(int x, int y) const;
+
+    // Returns the number of clusters whose edges were recomputed
+    int rebuildDirty();
+
+    // Same output format as findPath. Safe to call from several threads
+    // at once as long as nothing modifies the planner meanwhile.
+    bool findPath(int startX, int startY, int goalX, int goalY,
+                  GridPath& outPath, HpaStats* stats = nullptr) const;
+
+    int nodeCount() const;
+    int clusterCount() const { return clustersX * clustersY; }
+
+private:
+    struct Edge {
+        int to;
+        int cost;
+    };
+
+    struct Node {
+        int x, y;
+        int cluster;
+        int border;           // owning border (see borderIndex)
+        bool alive;
+        std::vector<Edge> edges;
+    };
+
+    int cell(int x, int y) const { return y * width + x; }
+    int clusterOf(int x, int y) const { return (y / clusterSize) * clustersX + (x / clusterSize); }
+    bool open(int x, int y) const {
+        return x >= 0 && x < width && y >= 0 && y < height && !blocked[cell(x, y)];
+    }
+    void clusterBounds(int c, int& x0, int& y0, int& x1, int& y1) const;
+
+    // Border between cluster c and its right (dir 0) or lower (dir 1) neighbour
+    int borderIndex(int c, int dir) const { return c * 2 + dir; }
+
+    int addNode(int x, int y, int border);
+    void removeBorderNodes(int border);
+    void buildBorder(int border);
+    void buildClusterEdges(int c);
+
+    // BFS confined to one cluster. Fills dist (cluster-local, -1 = not
+    // reached) and optionally parents for path extraction.
+    int clusterSearch(int c, int fromX, int fromY, std::vector<int>& dist,
+                      std::vector<int>* parent, int stopX = -1, int stopY = -1) const;
+    bool refine(int fromX, int fromY, int toX, int toY, GridPath& out, HpaStats* stats) const;
+
+    int clusterSize;
+    int width = 0, height = 0;
+    int clustersX = 0, clustersY = 0;
+    std::vector<uint8_t> blocked;
+
+    std::vector<Node> nodes;
+    std::vector<int> freeNodes;
+    std::vector<std::vector<int>> clusterNodes;
+    std::vector<std::vector<int>> borderNodes;
+    std::vector<uint8_t> dirty;
+};
@@ -0,0 +1,146 @@
+// ============================================================================
+// incremental.cpp
+// LPA* DISTANCE FIELD TO THE PLAYER, REPAIRED AS PEBBLES MOVE
+// ============================================================================
+
+#include "incremental.h"
+#include <algorithm>
+
+static const int INF = 1 << 29;
+static const int DIRS[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+void IncrementalPlanner::reset(const PathGrid& grid) {
+    width = grid.width;
+    height = grid.height;
+    goal = -1;
+
+    blocked.assign(width * height, 0);
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            blocked[cell(x, y)] = !grid.walkable(x, y);
+
+    g.assign(width * height, INF);
+    rhs.assign(width * height, INF);
+    open = decltype(open)();
+}
+
+bool IncrementalPlanner::isBlocked(int x, int y) const {
+    return !inBounds(x, y) || blocked[cell(x, y)];
+}
+
+void IncrementalPlanner::setBlocked(int x, int y, bool isBlocked) {
+    if (!inBounds(x, y)) return;
+    int c = cell(x, y);
+    if (blocked[c] == (uint8_t)isBlocked) return;
+    blocked[c] = isBlocked;
+    updateAround(c);
+}
+
+void IncrementalPlanner::setGoal(int x, int y) {
+    int next = inBounds(x, y) ? cell(x, y) : -1;
+    if (next == goal) return;
+
+    int old = goal;
+    goal = next;
+    if (old >= 0) updateVertex(old);
+    if (goal >= 0) updateVertex(goal);
+}
+
+void IncrementalPlanner::updateVertex(int c) {
+    if (c == goal) {
+        rhs[c] = blocked[c] ? INF : 0;
+    } else if (blocked[c]) {
+        rhs[c] = INF;
+    } else {
+        int x = c % width, y = c / width;
+        int best = INF;
+        for (auto& d : DIRS) {
+            int nx = x + d[0], ny = y + d[1];
+            if (!inBounds(nx, ny)) continue;
+            best = std::min(best, g[cell(nx, ny)] + 1);
+        }
+        rhs[c] = std::min(best, INF);
+    }
+
+    if (g[c] != rhs[c])
+        open.push({std::min(g[c], rhs[c]), c});
+}
+
+void IncrementalPlanner::updateAround(int c) {
+    updateVertex(c);
+    int x = c % width, y = c / width;
+    for (auto& d : DIRS) {
+        int nx = x + d[0], ny = y + d[1];
+        if (inBounds(nx, ny)) updateVertex(cell(nx, ny));
+    }
+}
+
+int IncrementalPlanner::repair() {
+    int expanded = 0;
+
+    while (!open.empty()) {
+        QueueEntry top = open.top();
+        open.pop();
+
+        int c = top.second;
+        // Stale entry: settled since, or re-queued under a different key
+        if (g[c] == rhs[c] || top.first != std::min(g[c], rhs[c])) continue;
+
+        expanded++;
+        if (g[c] > rhs[c]) {
+            g[c] = rhs[c];
+            int x = c % width, y = c / width;
+            for (auto& d : DIRS) {
+                int nx = x + d[0], ny = y + d[1];
+                if (inBounds(nx, ny)) updateVertex(cell(nx, ny));
+            }
+        } else {
+            g[c] = INF;
+            updateAround(c);
+        }
+    }
+
+    expansions += expanded;
+    return expanded;
+}
+
+int IncrementalPlanner::distance(int x, int y) const {
+    if (!inBounds(x, y)) return INF;
+    return g[cell(x, y)];
+}
+
+bool IncrementalPlanner::extractPath(int startX, int startY, GridPath& outPath) const {
+    outPath.clear();
+    if (goal < 0 || !inBounds(startX, startY) || cell(startX, startY) == goal) return false;
+
+    int x = startX, y = startY;
+    int remaining = width * height;
+
+    while (cell(x, y) != goal && remaining-- > 0) {
+        int bestX = -1, bestY = -1;
+        int best = g[cell(x, y)];
+        if (blocked[cell(x, y)]) best = INF;
+
+        for (auto& d : DIRS) {
+            int nx = x + d[0], ny = y + d[1];
+            if (!inBounds(nx, ny) || blocked[cell(nx, ny)]) continue;
+            int v = g[cell(nx, ny)];
+            if (v < best) {
+                best = v;
+                bestX = nx;
+                bestY = ny;
+            }
+        }
+
+        if (bestX < 0) {
+            outPath.clear();
+            return false;
+        }
+
+        x = bestX;
+        y = bestY;
+        outPath.push_back({x, y});
+    }
+
+    return cell(x, y) == goal;
+}
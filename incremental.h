@@ -0,0 +1,61 @@
+// ============================================================================
+// incremental.h
+// LPA* DISTANCE FIELD TO THE PLAYER, REPAIRED AS PEBBLES MOVE
+// ============================================================================
+
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <utility>
+#include <cstdint>
+#include "pathfinding.h"
+
+// Lifelong Planning A* run backwards from a single goal (the player's
+// cell) with a zero heuristic, so one search tree answers "next step
+// towards the goal" for every enemy at once. Walls come from the level
+// grid, pebbles are added as blocked cells.
+//
+// Changing a cell or moving the goal only puts the affected vertices back
+// on the queue; repair() then re-settles just those, instead of searching
+// from scratch. Moving the goal is modelled as changing the zero-cost edge
+// from a virtual source, so it goes through the same repair path.
+class IncrementalPlanner {
+public:
+    void reset(const PathGrid& grid);
+    bool ready() const { return width > 0; }
+
+    void setBlocked(int x, int y, bool blocked);
+    bool isBlocked(int x, int y) const;
+
+    void setGoal(int x, int y);
+    int goalX() const { return goal < 0 ? -1 : goal % width; }
+    int goalY() const { return goal < 0 ? -1 : goal / width; }
+
+    // Settles every inconsistent vertex; returns vertices expanded
+    int repair();
+
+    // Steps from (startX,startY) down the distance field to the goal, in
+    // the same format as findPath. The start cell itself may be blocked
+    // (a pebble slid onto an ant); it still walks off to a free neighbour.
+    bool extractPath(int startX, int startY, GridPath& outPath) const;
+
+    int distance(int x, int y) const;
+    long long totalExpansions() const { return expansions; }
+
+private:
+    typedef std::pair<int, int> QueueEntry;   // (key, cell)
+
+    int cell(int x, int y) const { return y * width + x; }
+    bool inBounds(int x, int y) const { return x >= 0 && x < width && y >= 0 && y < height; }
+    void updateVertex(int c);
+    void updateAround(int c);
+
+    int width = 0, height = 0;
+    int goal = -1;
+    std::vector<uint8_t> blocked;
+    std::vector<int> g, rhs;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+    long long expansions = 0;
+};
@@ -0,0 +1,115 @@
+// ============================================================================
+// intercept.cpp
+// PREDICTED PLAYER CELLS AND CACHED DISTANCE MAPS FOR INTERCEPTING ENEMIES
+// ============================================================================
+
+#include "intercept.h"
+#include <cmath>
+#include <algorithm>
+
+void PlayerMotion::update(float dx, float dy) {
+    // About the last eight ticks, so a tap does not swing the prediction
+    const float SMOOTHING = 0.125f;
+    vx += (dx - vx) * SMOOTHING;
+    vy += (dy - vy) * SMOOTHING;
+}
+
+const uint16_t* DistanceMaps::get(const PathGrid& grid, uint32_t version, int x, int y) {
+    int cell = y * grid.width + x;
+    useCounter++;
+
+    Map* slot = &maps[0];
+    for (Map& m : maps) {
+        if (m.cell == cell && m.version == version && (int)m.dist.size() == grid.width * grid.height) {
+            m.lastUse = useCounter;
+            return m.dist.data();
+        }
+        if (m.lastUse < slot->lastUse) slot = &m;
+    }
+
+    slot->cell = cell;
+    slot->version = version;
+    slot->lastUse = useCounter;
+    slot->dist.assign(grid.width * grid.height, UNREACHABLE);
+    buildCount++;
+    if (!grid.walkable(x, y)) return slot->dist.data();
+
+    static const int dirs[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+    frontier.clear();
+    frontier.push_back(cell);
+    slot->dist[cell] = 0;
+    for (size_t i = 0; i < frontier.size(); i++) {
+        int c = frontier[i];
+        int cx = c % grid.width, cy = c / grid.width;
+        for (const auto& d : dirs) {
+            int nx = cx + d[0], ny = cy + d[1];
+            if (!grid.walkable(nx, ny)) continue;
+            int n = ny * grid.width + nx;
+            if (slot->dist[n] != UNREACHABLE) continue;
+            slot->dist[n] = slot->dist[c] + 1;
+            frontier.push_back(n);
+        }
+    }
+    return slot->dist.data();
+}
+
+void InterceptTargets::predict(const PathGrid& grid, float feetX, float feetY, const PlayerMotion& motion,
+                               int horizons, int stepTicks, int tileSize)
+{
+    horizons = std::max(1, std::min(horizons, MAX_HORIZONS));
+    count = 0;
+
+    int lastX = (int)(feetX / tileSize), lastY = (int)(feetY / tileSize);
+    cellX[0] = lastX;
+    cellY[0] = lastY;
+    horizon[0] = 0;
+    dist[0] = nullptr;
+    count = 1;
+
+    // Probed every quarter cell, so the line does not step over a wall
+    float speed = std::max(std::fabs(motion.vx), std::fabs(motion.vy));
+    if (speed < 0.01f) return;
+    int ticksPerProbe = std::max(1, (int)(tileSize / 4 / speed));
+
+    int t = 0;
+    bool blocked = false;
+    for (int k = 1; k < horizons && !blocked; k++) {
+        while (t + ticksPerProbe <= k * stepTicks) {
+            t += ticksPerProbe;
+            int x = (int)std::floor((feetX + motion.vx * t) / tileSize);
+            int y = (int)std::floor((feetY + motion.vy * t) / tileSize);
+            if (!grid.walkable(x, y)) {
+                blocked = true;
+                break;
+            }
+            lastX = x;
+            lastY = y;
+        }
+        if (lastX == cellX[count - 1] && lastY == cellY[count - 1]) continue;
+        cellX[count] = lastX;
+        cellY[count] = lastY;
+        horizon[count] = k * stepTicks;
+        dist[count] = nullptr;
+        count++;
+    }
+}
+
+void InterceptTargets::fetchMaps(DistanceMaps& maps, const PathGrid& grid, uint32_t version) {
+    for (int k = 0; k < count; k++)
+        dist[k] = maps.get(grid, version, cellX[k], cellY[k]);
+}
+
+bool InterceptTargets::choose(int x, int y, int ticksPerCell, int width, int& gx, int& gy, int& meetTicks) const {
+    bool found = false;
+    for (int k = 0; k < count; k++) {
+        if (!dist[k] || dist[k][y * width + x] == DistanceMaps::UNREACHABLE) continue;
+        int meet = std::max(dist[k][y * width + x] * ticksPerCell, horizon[k]);
+        if (!found || meet < meetTicks) {
+            found = true;
+            meetTicks = meet;
+            gx = cellX[k];
+            gy = cellY[k];
+        }
+    }
+    return found;
+}
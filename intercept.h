@@ -0,0 +1,84 @@
+// ============================================================================
+// intercept.h
+// PREDICTED PLAYER CELLS AND CACHED DISTANCE MAPS FOR INTERCEPTING ENEMIES
+// ============================================================================
+//
+// An enemy that paths to where the player stands arrives where they were.
+// Intercepting instead looks at where the player will be after a few
+// horizons if they keep their recent velocity, and heads for the one it
+// can reach soonest:
+//
+//   meet(k) = max(distance(enemy, cell k) * enemy ticks per cell, horizon k)
+//
+// Horizon 0 is the player's own cell, so an enemy that cannot get ahead
+// of the player still chases them. Distances come from a breadth-first
+// map built once per candidate cell and map version and shared by every
+// enemy, so each enemy's choice is a few array reads.
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "pathfinding.h"
+
+// Smoothed per-tick displacement of one player, in pixels
+struct PlayerMotion {
+    float vx = 0, vy = 0;
+
+    // Feeds one tick's movement
+    void update(float dx, float dy);
+};
+
+// Walking distances (in cells, 4-connected, walls only) from single cells,
+// kept for the last few cells asked about on the current map version
+class DistanceMaps {
+public:
+    static constexpr uint16_t UNREACHABLE = 0xffff;
+    static const int MAX_MAPS = 16;
+
+    // The map from (x, y), built if it is not cached. Stays valid until
+    // MAX_MAPS other cells have been asked for.
+    const uint16_t* get(const PathGrid& grid, uint32_t version, int x, int y);
+
+    long long builds() const { return buildCount; }
+
+private:
+    struct Map {
+        int cell = -1;
+        uint32_t version = 0;
+        uint64_t lastUse = 0;
+        std::vector<uint16_t> dist;
+    };
+
+    Map maps[MAX_MAPS];
+    std::vector<int> frontier;
+    uint64_t useCounter = 0;
+    long long buildCount = 0;
+};
+
+// Candidate cells for one player this tick
+struct InterceptTargets {
+    static const int MAX_HORIZONS = 8;
+
+    int count = 0;
+    int cellX[MAX_HORIZONS], cellY[MAX_HORIZONS];
+    int horizon[MAX_HORIZONS];              // ticks ahead
+    const uint16_t* dist[MAX_HORIZONS];     // DistanceMaps entry, or nullptr
+
+    // Fills the candidates for a player whose feet are at (feetX, feetY)
+    // pixels, moving `motion`, looking `horizons` steps of `stepTicks`
+    // ahead. The prediction runs in a straight line and stops short of
+    // the first wall.
+    void predict(const PathGrid& grid, float feetX, float feetY, const PlayerMotion& motion,
+                 int horizons, int stepTicks, int tileSize);
+
+    // Looks up (or builds) the distance map of every candidate
+    void fetchMaps(DistanceMaps& maps, const PathGrid& grid, uint32_t version);
+
+    // Earliest meeting for an enemy at (x, y) that takes ticksPerCell per
+    // cell; false if it can reach none of the candidates
+    bool choose(int x, int y, int ticksPerCell, int width, int& gx, int& gy, int& meetTicks) const;
+};
+
+// Both players' candidates are fetched in one tick and must all stay cached
+static_assert(DistanceMaps::MAX_MAPS >= 2 * InterceptTargets::MAX_HORIZONS, "one tick's maps must fit");
@@ -0,0 +1,84 @@
+// ============================================================================
+// inventory.cpp
+// TYPED ITEM COUNTS
+// ============================================================================
+
+#include "inventory.h"
+#include <sstream>
+#include <algorithm>
+
+ItemId itemFromName(const std::string& name) {
+    for (int i = 0; i < NUM_ITEM_TYPES; i++)
+        if (name == ITEM_INFO[i].name) return (ItemId)i;
+    return NUM_ITEM_TYPES;
+}
+
+int Inventory::add(ItemId item, int n) {
+    int fit = std::min(n, ITEM_INFO[item].maxStack - counts[item]);
+    if (fit <= 0) return 0;
+    counts[item] += fit;
+    changed |= 1u << item;
+    return fit;
+}
+
+bool Inventory::take(ItemId item, int n) {
+    if (n <= 0 || counts[item] < n) return false;
+    counts[item] -= n;
+    changed |= 1u << item;
+    return true;
+}
+
+void Inventory::set(ItemId item, int n) {
+    n = std::max(0, std::min(n, ITEM_INFO[item].maxStack));
+    if (counts[item] == n) return;
+    counts[item] = n;
+    changed |= 1u << item;
+}
+
+void Inventory::clear() {
+    for (int i = 0; i < NUM_ITEM_TYPES; i++)
+        set((ItemId)i, 0);
+}
+
+uint32_t Inventory::takeChanges() {
+    uint32_t c = changed;
+    changed = 0;
+    return c;
+}
+
+std::string Inventory::toText() const {
+    std::ostringstream out;
+    for (int i = 0; i < NUM_ITEM_TYPES; i++)
+        if (counts[i] > 0) out << ITEM_INFO[i].name << " " << counts[i] << "\n";
+    return out.str();
+}
+
+bool Inventory::fromText(const std::string& text, std::string& error) {
+    int loaded[NUM_ITEM_TYPES] = {};
+
+    std::istringstream in(text);
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line)) {
+        lineNo++;
+        std::istringstream words(line);
+        std::string name;
+        if (!(words >> name) || name[0] == '#') continue;
+
+        ItemId item = itemFromName(name);
+        int n;
+        if (item == NUM_ITEM_TYPES) {
+            error = "line " + std::to_string(lineNo) + ": unknown item " + name;
+            return false;
+        }
+        if (!(words >> n) || n < 0 || n > ITEM_INFO[item].maxStack) {
+            error = "line " + std::to_string(lineNo) + ": bad count for " + name;
+            return false;
+        }
+        loaded[item] = n;
+    }
+
+    for (int i = 0; i < NUM_ITEM_TYPES; i++)
+        set((ItemId)i, loaded[i]);
+    return true;
+}
@@ -0,0 +1,68 @@
+// ============================================================================
+// inventory.h
+// TYPED ITEM COUNTS
+// ============================================================================
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// Every item the player can carry. Indexes Inventory's count array and
+// ITEM_INFO, so new types go here and in ITEM_INFO, in the same order.
+enum ItemId : uint8_t {
+    ITEM_BERRY,
+    ITEM_BAG,
+    NUM_ITEM_TYPES
+};
+
+struct ItemInfo {
+    const char* name;       // used by the text format
+    int maxStack;           // most the player can hold at once
+};
+
+inline constexpr ItemInfo ITEM_INFO[NUM_ITEM_TYPES] = {
+    {"berry", 99},
+    {"bag",   10},
+};
+
+constexpr bool itemInfoComplete() {
+    for (const ItemInfo& info : ITEM_INFO)
+        if (!info.name || info.maxStack <= 0) return false;
+    return true;
+}
+static_assert(itemInfoComplete(), "every ItemId needs a name and a stack size in ITEM_INFO");
+
+// Looks the name up in ITEM_INFO; NUM_ITEM_TYPES if there is none
+ItemId itemFromName(const std::string& name);
+
+// Item counts in a flat array, one slot per ItemId. Each change sets the
+// item's bit in a change mask that the HUD (or anything else showing
+// counts) takes once per frame, so unchanged counts cost nothing.
+class Inventory {
+public:
+    int count(ItemId item) const { return counts[item]; }
+
+    // Adds up to `n`, stopping at the item's maxStack; returns how many fit
+    int add(ItemId item, int n);
+
+    // Removes `n` if there are that many; false (and no change) otherwise
+    bool take(ItemId item, int n);
+
+    void set(ItemId item, int n);
+    void clear();
+
+    // Bit (1 << item) for each item changed since the last call
+    uint32_t takeChanges();
+
+    // "name count" lines for the non-zero items, e.g. "berry 3\nbag 10\n"
+    std::string toText() const;
+
+    // Replaces the contents with `text`; false (with the reason in `error`
+    // and nothing changed) for unknown items, bad counts or overfull stacks
+    bool fromText(const std::string& text, std::string& error);
+
+private:
+    int counts[NUM_ITEM_TYPES] = {};
+    uint32_t changed = 0;
+};
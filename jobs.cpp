@@ -0,0 +1,171 @@
+// ============================================================================
+// jobs.cpp
+// WORK-STEALING JOB SYSTEM
+// ============================================================================
+
+#include "jobs.h"
+#include <algorithm>
+
+// Which queue the current thread pushes to; threads not started by the
+// system (the GLUT thread) share queue 0.
+static thread_local const JobSystem* tlsOwner = nullptr;
+static thread_local int tlsIndex = 0;
+
+JobSystem::JobSystem(int numWorkers) {
+    if (numWorkers < 0)
+        numWorkers = std::max(0, (int)std::thread::hardware_concurrency() - 1);
+
+    for (int i = 0; i <= numWorkers; i++)
+        queues.emplace_back(new Queue());
+
+    for (int i = 1; i <= numWorkers; i++)
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        quitting = true;
+    }
+    sleepCv.notify_all();
+    for (auto& t : workers)
+        t.join();
+}
+
+int JobSystem::queueIndex() {
+    return tlsOwner == this ? tlsIndex : 0;
+}
+
+// ============================================================================
+// SUBMISSION
+// ============================================================================
+
+JobHandle JobSystem::add(std::function<void()> fn, std::initializer_list<JobHandle> deps) {
+    return add(std::move(fn), std::vector<JobHandle>(deps));
+}
+
+JobHandle JobSystem::add(std::function<void()> fn, const std::vector<JobHandle>& deps) {
+    JobHandle job = std::make_shared<Job>();
+    job->fn = std::move(fn);
+    job->self = job;
+
+    for (const auto& dep : deps) {
+        if (!dep) continue;
+        std::lock_guard<std::mutex> lock(dep->mutex);
+        if (dep->done) continue;
+        job->pendingDeps++;
+        dep->dependents.push_back(job);
+    }
+
+    if (--job->pendingDeps == 0)
+        schedule(job.get());
+    return job;
+}
+
+JobHandle JobSystem::addBatch(int count, int grain, std::function<void(int)> fn,
+                              std::initializer_list<JobHandle> deps)
+{
+    grain = std::max(1, grain);
+    auto shared = std::make_shared<std::function<void(int)>>(std::move(fn));
+
+    std::vector<JobHandle> parts;
+    for (int begin = 0; begin < count; begin += grain) {
+        int end = std::min(begin + grain, count);
+        parts.push_back(add([shared, begin, end] {
+            for (int i = begin; i < end; i++) (*shared)(i);
+        }, deps));
+    }
+    return add([] {}, parts);
+}
+
+void JobSystem::schedule(Job* job) {
+    Queue& q = *queues[queueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(q.mutex);
+        q.jobs.push_back(job);
+    }
+    queuedJobs++;
+
+    // Notify under the lock so a worker between its empty check and its
+    // wait cannot miss this job
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    sleepCv.notify_one();
+}
+
+// ============================================================================
+// EXECUTION
+// ============================================================================
+
+Job* JobSystem::popOrSteal(int self) {
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            Job* job = own.jobs.back();
+            own.jobs.pop_back();
+            return job;
+        }
+    }
+
+    int n = (int)queues.size();
+    for (int k = 1; k < n; k++) {
+        Queue& victim = *queues[(self + k) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            Job* job = victim.jobs.front();
+            victim.jobs.pop_front();
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::finish(Job* job) {
+    std::vector<JobHandle> ready;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->done = true;
+        ready.swap(job->dependents);
+    }
+
+    for (auto& dep : ready)
+        if (--dep->pendingDeps == 0)
+            schedule(dep.get());
+}
+
+bool JobSystem::runOne(int self) {
+    Job* job = popOrSteal(self);
+    if (!job) return false;
+    queuedJobs--;
+
+    job->fn();
+    job->fn = nullptr;
+    finish(job);
+    job->self.reset();  // may free the job if nobody holds a handle
+    return true;
+}
+
+void JobSystem::wait(const JobHandle& h) {
+    int self = queueIndex();
+    while (!isDone(h)) {
+        if (!runOne(self))
+            std::this_thread::yield();
+    }
+}
+
+bool JobSystem::isDone(const JobHandle& h) {
+    return !h || h->done;
+}
+
+void JobSystem::workerLoop(int index) {
+    tlsOwner = this;
+    tlsIndex = index;
+
+    for (;;) {
+        if (runOne(index)) continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCv.wait(lock, [&] { return quitting || queuedJobs > 0; });
+        if (quitting) return;
+    }
+}
@@ -0,0 +1,81 @@
+// ============================================================================
+// jobs.h
+// WORK-STEALING JOB SYSTEM
+// ============================================================================
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <initializer_list>
+
+struct Job;
+typedef std::shared_ptr<Job> JobHandle;
+
+// Each thread owns a queue: it pushes and pops at the back (newest first,
+// still warm in cache), idle threads steal from the front of other queues.
+// A job only becomes runnable once every dependency passed to add() has
+// finished. Threads calling wait() run queued jobs instead of blocking, so
+// with zero workers everything simply runs inline on the caller.
+class JobSystem {
+public:
+    // numWorkers < 0 picks hardware_concurrency()-1; the calling thread is
+    // always the extra one
+    explicit JobSystem(int numWorkers = -1);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    JobHandle add(std::function<void()> fn, std::initializer_list<JobHandle> deps = {});
+    JobHandle add(std::function<void()> fn, const std::vector<JobHandle>& deps);
+
+    // fn(i) for i in [0,count) split into jobs of `grain` indices; the
+    // returned handle finishes when all of them have
+    JobHandle addBatch(int count, int grain, std::function<void(int)> fn,
+                       std::initializer_list<JobHandle> deps = {});
+
+    // Runs other jobs until h has finished. Null handles are already done.
+    void wait(const JobHandle& h);
+    static bool isDone(const JobHandle& h);
+
+    int threadCount() const { return (int)workers.size() + 1; }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job*> jobs;
+    };
+
+    void schedule(Job* job);
+    void finish(Job* job);
+    bool runOne(int self);
+    Job* popOrSteal(int self);
+    int queueIndex();
+    void workerLoop(int index);
+
+    std::vector<std::unique_ptr<Queue>> queues;   // 0 belongs to non-worker threads
+    std::vector<std::thread> workers;
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCv;
+    std::atomic<int> queuedJobs{0};
+    bool quitting = false;
+};
+
+struct Job {
+    std::function<void()> fn;
+    std::atomic<int> pendingDeps{1};   // +1 held by add() until registration ends
+    std::atomic<bool> done{false};
+
+    std::mutex mutex;                  // guards dependents against finish()
+    std::vector<JobHandle> dependents;
+
+    JobHandle self;                    // keeps the job alive while queued
+};
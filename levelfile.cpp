@@ -0,0 +1,157 @@
+// ============================================================================
+// levelfile.cpp
+// TEXT LEVEL FILES FOR THE EDITOR AND HOT RELOAD
+// ============================================================================
+
+#include "levelfile.h"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+static const char* const PATH_MODE_NAMES[] = {"astar", "jps", "incremental", "hierarchical"};
+static const int NUM_PATH_MODES = 4;
+
+std::string levelFileName(int level) {
+    return "level" + std::to_string(level) + ".txt";
+}
+
+std::string levelFilePath(int level) {
+    return std::string(LEVEL_DIR) + "/" + levelFileName(level);
+}
+
+int levelFromFileName(const std::string& name) {
+    for (int i = 0; i < NUM_LEVELS; i++)
+        if (name == levelFileName(i)) return i;
+    return -1;
+}
+
+std::string levelToText(const LevelData& level) {
+    std::ostringstream out;
+    out << "# roach level\n";
+    out << "pathmode " << PATH_MODE_NAMES[level.pathMode] << "\n";
+
+    out << "tiles\n";
+    for (int r = 0; r < LEVEL_ROWS; r++) {
+        for (int c = 0; c < LEVEL_COLS; c++)
+            out << (level.tiles[r][c] == 1 ? '1' : '0');
+        out << "\n";
+    }
+
+    for (const auto& p : level.portals)
+        out << "portal " << p.x << " " << p.y << " " << p.portalID << " "
+            << p.targetLevel << " " << p.targetPortalID << "\n";
+    for (const auto& b : level.berries)
+        out << "berry " << b.x << " " << b.y << " " << b.berryID << "\n";
+    for (const auto& e : level.enemies)
+        out << "enemy " << e.x << " " << e.y << " " << e.enemyID << "\n";
+    for (const auto& p : level.pebbles)
+        out << "pebble " << p.x << " " << p.y << " " << p.pebbleID << "\n";
+
+    return out.str();
+}
+
+bool levelFromText(const std::string& text, LevelData& out, std::string& error) {
+    LevelData level = {};
+    bool haveTiles = false;
+
+    std::istringstream in(text);
+    std::string line;
+    int lineNo = 0;
+
+    auto fail = [&](const char* what) {
+        error = "line " + std::to_string(lineNo) + ": " + what;
+        return false;
+    };
+
+    while (std::getline(in, line)) {
+        lineNo++;
+        std::istringstream words(line);
+        std::string kind;
+        if (!(words >> kind) || kind[0] == '#') continue;
+
+        if (kind == "pathmode") {
+            std::string name;
+            words >> name;
+            int mode = -1;
+            for (int i = 0; i < NUM_PATH_MODES; i++)
+                if (name == PATH_MODE_NAMES[i]) mode = i;
+            if (mode < 0) return fail("unknown path mode");
+            level.pathMode = (PathMode)mode;
+        }
+        else if (kind == "tiles") {
+            for (int r = 0; r < LEVEL_ROWS; r++) {
+                lineNo++;
+                if (!std::getline(in, line)) return fail("expected 18 tile rows");
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if ((int)line.size() != LEVEL_COLS) return fail("tile row is not 25 cells");
+                for (int c = 0; c < LEVEL_COLS; c++) {
+                    if (line[c] != '0' && line[c] != '1') return fail("tile is not 0 or 1");
+                    level.tiles[r][c] = line[c] - '0';
+                }
+            }
+            haveTiles = true;
+        }
+        else if (kind == "portal") {
+            PortalDef p;
+            if (!(words >> p.x >> p.y >> p.portalID >> p.targetLevel >> p.targetPortalID))
+                return fail("portal needs x y id targetLevel targetPortalID");
+            if (!level.portals.push_back(p)) return fail("too many portals");
+        }
+        else if (kind == "berry") {
+            BerryDef b;
+            if (!(words >> b.x >> b.y >> b.berryID)) return fail("berry needs x y id");
+            if (!level.berries.push_back(b)) return fail("too many berries");
+        }
+        else if (kind == "enemy") {
+            EnemyDef e;
+            if (!(words >> e.x >> e.y >> e.enemyID)) return fail("enemy needs x y id");
+            if (!level.enemies.push_back(e)) return fail("too many enemies");
+        }
+        else if (kind == "pebble") {
+            PebbleDef p;
+            if (!(words >> p.x >> p.y >> p.pebbleID)) return fail("pebble needs x y id");
+            if (!level.pebbles.push_back(p)) return fail("too many pebbles");
+        }
+        else {
+            return fail("unknown entry");
+        }
+    }
+
+    if (!haveTiles) {
+        lineNo = 0;
+        return fail("no tiles section");
+    }
+
+    out = level;
+    return true;
+}
+
+bool readLevelFile(const std::string& path, LevelData& out, std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+
+    if (!levelFromText(text.str(), out, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool writeLevelFile(const std::string& path, const LevelData& level) {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+        file << levelToText(level);
+        if (!file.flush()) return false;
+    }
+#ifdef _WIN32
+    std::remove(path.c_str());     // rename() will not replace a file here
+#endif
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,36 @@
+// ============================================================================
+// levelfile.h
+// TEXT LEVEL FILES FOR THE EDITOR AND HOT RELOAD
+// ============================================================================
+//
+//   # comment
+//   pathmode jps                  astar | jps | incremental | hierarchical
+//   tiles                         followed by 18 rows of 25 '0'/'1'
+//   portal  x y id targetLevel targetPortalID
+//   berry   x y id
+//   enemy   x y id
+//   pebble  x y id
+
+#pragma once
+
+#include <string>
+#include "Levels.h"
+
+// levels/level<N>.txt, relative to the working directory like the textures
+const char* const LEVEL_DIR = "levels";
+std::string levelFileName(int level);     // "level<N>.txt"
+std::string levelFilePath(int level);     // LEVEL_DIR + "/" + name
+
+// Level number for a file name produced by levelFileName, or -1
+int levelFromFileName(const std::string& name);
+
+std::string levelToText(const LevelData& level);
+
+// On failure leaves `out` untouched and describes the first bad line
+bool levelFromText(const std::string& text, LevelData& out, std::string& error);
+
+bool readLevelFile(const std::string& path, LevelData& out, std::string& error);
+
+// Writes to a temporary file and renames it over `path`, so a watcher
+// never sees half a level
+bool writeLevelFile(const std::string& path, const LevelData& level);
@@ -0,0 +1,222 @@
+// ============================================================================
+// levelgen.cpp
+// PROCEDURAL STRESS LEVELS
+// ============================================================================
+
+#include "levelgen.h"
+#include <random>
+#include <algorithm>
+#include <utility>
+#include <cstdlib>
+#include <cstdint>
+
+const char* shapeName(LevelShape shape) {
+    switch (shape) {
+        case SHAPE_MAZE:  return "maze";
+        case SHAPE_CAVES: return "caves";
+        case SHAPE_ARENA: return "arena";
+    }
+    return "?";
+}
+
+// Enemies start at least this many cells (in x or y) from the spawn
+static const int SPAWN_CLEARANCE = 4;
+
+static void carveMaze(GeneratedLevel& L, std::mt19937& rng) {
+    std::fill(L.tiles.begin(), L.tiles.end(), 1);
+
+    // Recursive backtracker over the odd cells, walls on the even ones
+    std::vector<std::pair<int, int>> stack = {{1, 1}};
+    L.tiles[1 * L.width + 1] = 0;
+    static const int dirs[4][2] = {{0, -2}, {0, 2}, {-2, 0}, {2, 0}};
+    while (!stack.empty()) {
+        auto [x, y] = stack.back();
+        int options[4], n = 0;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + dirs[d][0], ny = y + dirs[d][1];
+            if (nx > 0 && ny > 0 && nx < L.width - 1 && ny < L.height - 1 && L.wall(nx, ny))
+                options[n++] = d;
+        }
+        if (n == 0) {
+            stack.pop_back();
+            continue;
+        }
+        const int* d = dirs[options[rng() % n]];
+        L.tiles[(y + d[1] / 2) * L.width + x + d[0] / 2] = 0;
+        L.tiles[(y + d[1]) * L.width + x + d[0]] = 0;
+        stack.push_back({x + d[0], y + d[1]});
+    }
+
+    // Knock through one wall in ten between two corridors, so there is
+    // more than one way round
+    for (int y = 1; y < L.height - 1; y++)
+        for (int x = 1; x < L.width - 1; x++) {
+            if (!L.wall(x, y) || rng() % 10 != 0) continue;
+            bool horizontal = !L.wall(x - 1, y) && !L.wall(x + 1, y);
+            bool vertical = !L.wall(x, y - 1) && !L.wall(x, y + 1);
+            if (horizontal != vertical) L.tiles[y * L.width + x] = 0;
+        }
+}
+
+static void growCaves(GeneratedLevel& L, std::mt19937& rng) {
+    for (int& t : L.tiles) t = rng() % 100 < 45 ? 1 : 0;
+
+    std::vector<int> next(L.tiles.size());
+    for (int pass = 0; pass < 5; pass++) {
+        for (int y = 0; y < L.height; y++)
+            for (int x = 0; x < L.width; x++) {
+                int walls = 0;
+                for (int dy = -1; dy <= 1; dy++)
+                    for (int dx = -1; dx <= 1; dx++) {
+                        int nx = x + dx, ny = y + dy;
+                        if (nx < 0 || ny < 0 || nx >= L.width || ny >= L.height || L.wall(nx, ny))
+                            walls++;
+                    }
+                next[y * L.width + x] = walls >= 5 ? 1 : 0;
+            }
+        L.tiles.swap(next);
+    }
+}
+
+static void scatterPillars(GeneratedLevel& L, std::mt19937& rng) {
+    std::fill(L.tiles.begin(), L.tiles.end(), 0);
+    int pillars = L.width * L.height / 40;
+    for (int i = 0; i < pillars; i++) {
+        int x = 1 + rng() % (L.width - 2), y = 1 + rng() % (L.height - 2);
+        for (int dy = 0; dy < 2; dy++)
+            for (int dx = 0; dx < 2; dx++)
+                if (x + dx < L.width && y + dy < L.height)
+                    L.tiles[(y + dy) * L.width + x + dx] = 1;
+    }
+}
+
+// Runs a corridor from the spawn to the largest open region, when the
+// spawn is not already in it (caves are mostly separate pockets)
+static void joinLargestRegion(GeneratedLevel& L) {
+    std::vector<int> label(L.tiles.size(), -1);
+    std::vector<int> stack;
+    int largest = -1, largestSize = 0, largestCell = 0;
+    for (int start = 0; start < (int)L.tiles.size(); start++) {
+        if (L.tiles[start] == 1 || label[start] >= 0) continue;
+        int id = start, size = 0;
+        label[start] = id;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            int k = stack.back();
+            stack.pop_back();
+            size++;
+            const int next[4] = {k - L.width, k + L.width, k - 1, k + 1};
+            for (int n : next)
+                if (L.tiles[n] != 1 && label[n] < 0) {
+                    label[n] = id;
+                    stack.push_back(n);
+                }
+        }
+        if (size > largestSize) {
+            largest = id;
+            largestSize = size;
+            largestCell = start;
+        }
+    }
+    if (largest < 0 || label[SPAWN_Y * L.width + SPAWN_X] == largest) return;
+
+    int tx = largestCell % L.width, ty = largestCell / L.width;
+    for (int x = std::min(SPAWN_X, tx); x <= std::max(SPAWN_X, tx); x++)
+        L.tiles[SPAWN_Y * L.width + x] = 0;
+    for (int y = std::min(SPAWN_Y, ty); y <= std::max(SPAWN_Y, ty); y++)
+        L.tiles[y * L.width + tx] = 0;
+}
+
+// Floor cells reachable from the spawn; everything else becomes wall, so
+// no entity is shut away where nothing can reach it
+static std::vector<std::pair<int, int>> keepSpawnRegion(GeneratedLevel& L) {
+    std::vector<uint8_t> seen(L.tiles.size(), 0);
+    std::vector<std::pair<int, int>> region = {{SPAWN_X, SPAWN_Y}};
+    seen[SPAWN_Y * L.width + SPAWN_X] = 1;
+    static const int dirs[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+    for (size_t i = 0; i < region.size(); i++) {
+        auto [x, y] = region[i];
+        for (const auto& d : dirs) {
+            int nx = x + d[0], ny = y + d[1];
+            int k = ny * L.width + nx;
+            if (L.wall(nx, ny) || seen[k]) continue;
+            seen[k] = 1;
+            region.push_back({nx, ny});
+        }
+    }
+    for (size_t k = 0; k < L.tiles.size(); k++)
+        if (!seen[k]) L.tiles[k] = 1;
+    return region;
+}
+
+GeneratedLevel generateLevel(const LevelGenParams& params) {
+    GeneratedLevel L;
+    L.width = std::max(params.width, 2 * SPAWN_CLEARANCE);
+    L.height = std::max(params.height, 2 * SPAWN_CLEARANCE);
+    L.tiles.assign(L.width * L.height, 0);
+    L.pathMode = params.shape == SHAPE_ARENA ? PATH_JPS : PATH_ASTAR;
+
+    std::mt19937 rng(params.seed);
+    switch (params.shape) {
+        case SHAPE_MAZE:  carveMaze(L, rng); break;
+        case SHAPE_CAVES: growCaves(L, rng); break;
+        case SHAPE_ARENA: scatterPillars(L, rng); break;
+    }
+
+    // Walled border, and a clear room around the spawn
+    for (int x = 0; x < L.width; x++)
+        L.tiles[x] = L.tiles[(L.height - 1) * L.width + x] = 1;
+    for (int y = 0; y < L.height; y++)
+        L.tiles[y * L.width] = L.tiles[y * L.width + L.width - 1] = 1;
+    for (int y = SPAWN_Y - 1; y <= SPAWN_Y + 1; y++)
+        for (int x = SPAWN_X - 1; x <= SPAWN_X + 1; x++)
+            L.tiles[y * L.width + x] = 0;
+
+    joinLargestRegion(L);
+    std::vector<std::pair<int, int>> cells = keepSpawnRegion(L);
+    cells.erase(std::remove_if(cells.begin(), cells.end(), [](const std::pair<int, int>& c) {
+        return std::abs(c.first - SPAWN_X) < SPAWN_CLEARANCE && std::abs(c.second - SPAWN_Y) < SPAWN_CLEARANCE;
+    }), cells.end());
+    std::shuffle(cells.begin(), cells.end(), rng);
+    if (cells.empty()) return L;
+
+    // Pebbles first, each on its own cell; berries and enemies share the rest
+    size_t pebbles = std::min(cells.size() - 1, (size_t)(cells.size() * std::max(0.0f, params.pebbleDensity)));
+    for (size_t i = 0; i < pebbles; i++)
+        L.pebbles.push_back({cells[i].first, cells[i].second, (int)i});
+
+    size_t open = cells.size() - pebbles;
+    for (int i = 0; i < params.items && i < (int)open; i++) {
+        const auto& c = cells[pebbles + i];
+        L.berries.push_back({c.first, c.second, i});
+    }
+    for (int i = 0; i < params.enemies; i++) {
+        const auto& c = cells[pebbles + (open - 1 - i % open)];
+        L.enemies.push_back({c.first, c.second, i});
+    }
+    return L;
+}
+
+bool toLevelData(const GeneratedLevel& level, LevelData& out, std::string& error) {
+    if (level.width != LEVEL_COLS || level.height != LEVEL_ROWS) {
+        error = "level is " + std::to_string(level.width) + "x" + std::to_string(level.height) +
+                ", not " + std::to_string(LEVEL_COLS) + "x" + std::to_string(LEVEL_ROWS);
+        return false;
+    }
+    if (level.enemies.size() > MAX_LEVEL_ENEMIES || level.pebbles.size() > MAX_LEVEL_PEBBLES ||
+        level.berries.size() > MAX_LEVEL_BERRIES) {
+        error = "more entities than a level file holds";
+        return false;
+    }
+
+    LevelData L;
+    for (int y = 0; y < LEVEL_ROWS; y++)
+        for (int x = 0; x < LEVEL_COLS; x++)
+            L.tiles[y][x] = level.tiles[y * level.width + x];
+    for (const auto& d : level.enemies) L.enemies.push_back(d);
+    for (const auto& d : level.pebbles) L.pebbles.push_back(d);
+    for (const auto& d : level.berries) L.berries.push_back(d);
+    L.pathMode = level.pathMode;
+    out = L;
+    return true;
+}
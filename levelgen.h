@@ -0,0 +1,52 @@
+// ============================================================================
+// levelgen.h
+// PROCEDURAL STRESS LEVELS
+// ============================================================================
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Levels.h"
+
+enum LevelShape {
+    SHAPE_MAZE,     // corridors one cell wide, with a few loops
+    SHAPE_CAVES,    // cellular automaton blobs, one connected cave kept
+    SHAPE_ARENA,    // open floor with scattered pillars
+};
+
+const char* shapeName(LevelShape shape);
+
+struct LevelGenParams {
+    LevelShape shape = SHAPE_ARENA;
+    int width = LEVEL_COLS;
+    int height = LEVEL_ROWS;
+    int enemies = 0;            // stack several to a cell once every cell has one
+    float pebbleDensity = 0;    // fraction of the reachable floor
+    int items = 0;              // berries, at most one per cell
+    unsigned seed = 1;
+};
+
+// A level of any size with no limit on entities. The player starts at
+// cell (2, 2) like on the built-in levels; every entity is on floor that
+// connects to it, and none starts within a few cells of it.
+struct GeneratedLevel {
+    int width = 0, height = 0;
+    std::vector<int> tiles;             // row-major, 1 = wall
+    std::vector<EnemyDef> enemies;
+    std::vector<PebbleDef> pebbles;
+    std::vector<BerryDef> berries;
+    PathMode pathMode = PATH_ASTAR;     // JPS for arenas
+
+    bool wall(int x, int y) const { return tiles[y * width + x] == 1; }
+};
+
+const int SPAWN_X = 2, SPAWN_Y = 2;
+
+// Same params and seed, same level
+GeneratedLevel generateLevel(const LevelGenParams& params);
+
+// For generated levels that fit the editor's format: LEVEL_COLS x
+// LEVEL_ROWS and within the MAX_LEVEL_* counts. False with the reason in
+// `error` otherwise.
+bool toLevelData(const GeneratedLevel& level, LevelData& out, std::string& error);
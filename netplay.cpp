@@ -0,0 +1,296 @@
+// ============================================================================
+// netplay.cpp
+// TWO-PLAYER LOCKSTEP OVER UDP, WITH INPUT DELAY AND ROLLBACK
+// ============================================================================
+
+#include "netplay.h"
+#include <cstring>
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// ----------------------------------------------------------------------------
+// UDP link
+// ----------------------------------------------------------------------------
+
+UdpLink::~UdpLink() {
+    close();
+}
+
+bool UdpLink::open(int localPort, const std::string& peerHost, int peerPortNumber, std::string& error) {
+    close();
+
+#if defined(_WIN32)
+    static bool started = false;
+    if (!started) {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+            error = "winsock unavailable";
+            return false;
+        }
+        started = true;
+    }
+#endif
+
+    std::string host = peerHost == "localhost" ? "127.0.0.1" : peerHost;
+    in_addr addr;
+    if (inet_pton(AF_INET, host.c_str(), &addr) != 1) {
+        error = "not an IPv4 address: " + peerHost;
+        return false;
+    }
+    peerAddr = addr.s_addr;
+    peerPort = htons((uint16_t)peerPortNumber);
+
+    sock = (intptr_t)socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        error = "cannot create a UDP socket";
+        return false;
+    }
+
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons((uint16_t)localPort);
+    if (bind(sock, (sockaddr*)&local, sizeof(local)) != 0) {
+        error = "cannot bind UDP port " + std::to_string(localPort);
+        close();
+        return false;
+    }
+
+#if defined(_WIN32)
+    u_long nonBlocking = 1;
+    ioctlsocket(sock, FIONBIO, &nonBlocking);
+#else
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    return true;
+}
+
+void UdpLink::close() {
+    if (sock < 0) return;
+#if defined(_WIN32)
+    closesocket(sock);
+#else
+    ::close(sock);
+#endif
+    sock = -1;
+    delayed.clear();
+}
+
+void UdpLink::setConditions(const NetConditions& c, const TimeSource& source) {
+    conditions = c;
+    time = &source;
+    rng.seed(c.seed);
+}
+
+void UdpLink::sendNow(const uint8_t* data, int size) {
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = peerAddr;
+    to.sin_port = peerPort;
+    // Nobody listening yet is not an error; the next packet repeats this one
+    sendto(sock, (const char*)data, size, 0, (sockaddr*)&to, sizeof(to));
+}
+
+void UdpLink::send(const uint8_t* data, int size) {
+    if (sock < 0) return;
+    sentBytes += size;
+    sentPackets++;
+
+    if (conditions.loss > 0 && std::uniform_real_distribution<float>(0, 1)(rng) < conditions.loss)
+        return;
+    if (conditions.latencyMs <= 0 && conditions.jitterMs <= 0) {
+        sendNow(data, size);
+        return;
+    }
+
+    int ms = conditions.latencyMs;
+    if (conditions.jitterMs > 0) ms += rng() % (conditions.jitterMs + 1);
+    Delayed d{time->now() + ms * NANOS_PER_MILLI, std::vector<uint8_t>(data, data + size)};
+    auto at = std::upper_bound(delayed.begin(), delayed.end(), d.due,
+                               [](Nanos due, const Delayed& e) { return due < e.due; });
+    delayed.insert(at, std::move(d));
+}
+
+void UdpLink::flushDelayed() {
+    Nanos now = time->now();
+    while (!delayed.empty() && delayed.front().due <= now) {
+        sendNow(delayed.front().data.data(), (int)delayed.front().data.size());
+        delayed.pop_front();
+    }
+}
+
+int UdpLink::receive(uint8_t* buf, int capacity) {
+    if (sock < 0) return -1;
+    flushDelayed();
+
+    for (;;) {
+        sockaddr_in from = {};
+        socklen_t len = sizeof(from);
+        int n = (int)recvfrom(sock, (char*)buf, capacity, 0, (sockaddr*)&from, &len);
+        if (n < 0) return -1;
+        if (from.sin_addr.s_addr == peerAddr && from.sin_port == peerPort) return n;
+        // Anyone else's datagram is ignored
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Lockstep session
+// ----------------------------------------------------------------------------
+
+static const int MAX_INPUTS_PER_PACKET = 240;
+static const int HEADER_BYTES = 5;
+
+// Full tick number for a 16-bit one, taking the nearest to `near`
+static int unwrapTick(uint16_t low, int near) {
+    return near + (int16_t)(uint16_t)(low - (uint16_t)near);
+}
+
+bool LockstepSession::start(World& w, const NetplayConfig& cfg, int localPort,
+                            const std::string& peerHost, int peerPort, std::string& error)
+{
+    config = cfg;
+    config.inputDelay = std::max(0, config.inputDelay);
+    config.maxRollback = std::max(1, config.maxRollback);
+
+    w.pathBudget.maxSteps = 0;
+    w.pathBudget.maxMicros = 0;
+    snapshots.resize(config.maxRollback + 1);
+    if (!snapshots.save(0, w)) {
+        error = "the level is too large to roll back";
+        return false;
+    }
+    if (!udp.open(localPort, peerHost, peerPort, error)) return false;
+
+    currentTick = 0;
+    localInputs.assign(config.inputDelay, 0);
+    remoteInputs.clear();
+    usedRemote.clear();
+    peerHas = 0;
+    rollbackFrom = -1;
+    counters = NetplayStats();
+    return true;
+}
+
+// Until the peer's input for `t` arrives, they are taken to still be
+// holding whatever they held last
+uint8_t LockstepSession::remoteInputFor(int t) const {
+    if (t < (int)remoteInputs.size()) return remoteInputs[t];
+    return remoteInputs.empty() ? 0 : remoteInputs.back();
+}
+
+uint8_t LockstepSession::combinedInput(int t) const {
+    uint8_t local = localInputs[t] & INPUT_PLAYER_MASK;
+    uint8_t remote = usedRemote[t] & INPUT_PLAYER_MASK;
+    if (config.localPlayer == 0) return local | (remote << INPUT_PARTNER_SHIFT);
+    return remote | (local << INPUT_PARTNER_SHIFT);
+}
+
+void LockstepSession::stepTick(World& w, int t) {
+    if ((int)usedRemote.size() <= t) usedRemote.resize(t + 1);
+    usedRemote[t] = remoteInputFor(t);
+    w.step(combinedInput(t), (long long)(t + 1) * config.tickMs);
+}
+
+void LockstepSession::receive() {
+    uint8_t buf[HEADER_BYTES + MAX_INPUTS_PER_PACKET / 2 + 1];
+    int n;
+    while ((n = udp.receive(buf, sizeof(buf))) >= 0) {
+        if (n < HEADER_BYTES) continue;
+        int ack = unwrapTick((uint16_t)(buf[0] | buf[1] << 8), peerHas);
+        int first = unwrapTick((uint16_t)(buf[2] | buf[3] << 8), (int)remoteInputs.size());
+        int count = std::min((int)buf[4], (n - HEADER_BYTES) * 2);
+
+        if (ack > peerHas && ack <= (int)localInputs.size()) peerHas = ack;
+
+        for (int i = 0; i < count; i++) {
+            int t = first + i;
+            if (t < (int)remoteInputs.size()) continue;
+            if (t > (int)remoteInputs.size()) break;     // a gap; a later packet fills it
+
+            uint8_t input = (buf[HEADER_BYTES + i / 2] >> (i % 2 * 4)) & INPUT_PLAYER_MASK;
+            remoteInputs.push_back(input);
+            if (t < currentTick && usedRemote[t] != input && (rollbackFrom < 0 || t < rollbackFrom))
+                rollbackFrom = t;
+        }
+    }
+}
+
+void LockstepSession::sendInputs() {
+    int first = peerHas;
+    int count = std::min((int)localInputs.size() - first, MAX_INPUTS_PER_PACKET);
+
+    uint8_t buf[HEADER_BYTES + MAX_INPUTS_PER_PACKET / 2 + 1] = {};
+    uint16_t ack = (uint16_t)remoteInputs.size();
+    buf[0] = ack & 0xff;
+    buf[1] = ack >> 8;
+    buf[2] = first & 0xff;
+    buf[3] = (first >> 8) & 0xff;
+    buf[4] = (uint8_t)count;
+    for (int i = 0; i < count; i++)
+        buf[HEADER_BYTES + i / 2] |= (localInputs[first + i] & INPUT_PLAYER_MASK) << (i % 2 * 4);
+    udp.send(buf, HEADER_BYTES + (count + 1) / 2);
+}
+
+void LockstepSession::catchUp(World& w) {
+    receive();
+
+    // A wrong guess: back to the world before that tick, then forward
+    // again through every tick since with what is now known
+    if (rollbackFrom >= 0) {
+        bool verbose = w.verbose;
+        snapshots.restore(rollbackFrom, w);
+        w.verbose = false;
+        for (int t = rollbackFrom; t < currentTick; t++) {
+            snapshots.save(t, w);
+            stepTick(w, t);
+            counters.replayedTicks++;
+        }
+        w.verbose = verbose;
+        counters.rollbacks++;
+        rollbackFrom = -1;
+    }
+}
+
+void LockstepSession::sync(World& w) {
+    catchUp(w);
+    sendInputs();
+}
+
+bool LockstepSession::advance(World& w, uint8_t localInput) {
+    catchUp(w);
+
+    if (currentTick - (int)remoteInputs.size() >= config.maxRollback) {
+        counters.stalls++;
+        sendInputs();
+        return false;
+    }
+
+    localInputs.push_back(localInput & INPUT_PLAYER_MASK);
+    // Levels from a level table always fit the rollback state
+    snapshots.save(currentTick, w);
+    stepTick(w, currentTick);
+    currentTick++;
+    counters.ticks++;
+
+    sendInputs();
+    return true;
+}
+
+NetplayStats LockstepSession::stats() const {
+    NetplayStats s = counters;
+    s.confirmedTicks = std::min(currentTick, (int)remoteInputs.size());
+    s.bytesSent = udp.bytesSent();
+    s.packetsSent = udp.packetsSent();
+    return s;
+}
@@ -0,0 +1,148 @@
+// ============================================================================
+// netplay.h
+// TWO-PLAYER LOCKSTEP OVER UDP, WITH INPUT DELAY AND ROLLBACK
+// ============================================================================
+//
+// Both machines run the same World and only exchange input: one nibble of
+// InputBits per player per tick. Each side applies its own input a few
+// ticks late (inputDelay) and guesses the other player's input as "same
+// as last time" until it arrives. A guess that turns out wrong rolls the
+// world back to that tick and replays the ticks since with the real input.
+//
+// Packet, little endian:
+//   u16 ack           ticks of the receiver's input the sender has, mod 2^16
+//   u16 first         tick of the first input carried, mod 2^16
+//   u8  count         inputs carried
+//   count nibbles     the sender's input for ticks first.., two per byte
+//
+// Every packet repeats the inputs the peer has not acknowledged yet, so
+// a lost packet costs nothing but latency.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <random>
+#include <cstdint>
+#include "clock.h"
+#include "world.h"
+#include "rollback.h"
+
+// Applied to outgoing packets, to try netplay on one machine
+struct NetConditions {
+    int latencyMs = 0;          // one way
+    int jitterMs = 0;           // added latency, uniform in [0, jitterMs]
+    float loss = 0;             // chance a packet is dropped, 0..1
+    unsigned seed = 1;
+};
+
+// Non-blocking UDP socket talking to one peer
+class UdpLink {
+public:
+    UdpLink() = default;
+    ~UdpLink();
+
+    UdpLink(const UdpLink&) = delete;
+    UdpLink& operator=(const UdpLink&) = delete;
+
+    // Binds localPort on all interfaces; packets go to peerHost:peerPort
+    // (a dotted IPv4 address or "localhost")
+    bool open(int localPort, const std::string& peerHost, int peerPort, std::string& error);
+    void close();
+
+    void setConditions(const NetConditions& c, const TimeSource& time = steadyTime());
+
+    // Sends now, or later / never under simulated conditions
+    void send(const uint8_t* data, int size);
+
+    // Next datagram from the peer into `buf`, or -1 if none is waiting.
+    // Also sends any delayed packets that have come due.
+    int receive(uint8_t* buf, int capacity);
+
+    long long bytesSent() const { return sentBytes; }
+    long long packetsSent() const { return sentPackets; }
+
+private:
+    struct Delayed {
+        Nanos due;
+        std::vector<uint8_t> data;
+    };
+
+    void sendNow(const uint8_t* data, int size);
+    void flushDelayed();
+
+    intptr_t sock = -1;
+    uint32_t peerAddr = 0;          // network byte order
+    uint16_t peerPort = 0;
+    NetConditions conditions;
+    const TimeSource* time = &steadyTime();
+    std::deque<Delayed> delayed;    // in due order
+    std::mt19937 rng;
+    long long sentBytes = 0, sentPackets = 0;
+};
+
+struct NetplayConfig {
+    int localPlayer = 0;        // 0 = World::player, 1 = World::partner
+    int inputDelay = 2;         // ticks before local input takes effect
+    int maxRollback = 8;        // ticks ahead of the peer before stalling
+    int tickMs = 16;
+};
+
+struct NetplayStats {
+    int ticks = 0;              // simulated, not counting replays
+    int confirmedTicks = 0;     // with both players' input known
+    int rollbacks = 0;
+    int replayedTicks = 0;      // resimulated after a rollback
+    int stalls = 0;             // advance() calls spent waiting for the peer
+    long long bytesSent = 0;    // UDP payload
+    long long packetsSent = 0;
+};
+
+// Runs one side of a two-player game. The world must be set up the same
+// way on both sides (level, hasPartner, no PathWorker) and then only be
+// changed through advance(). start() lifts the path step limit, so every
+// tick finishes its searches and can be rolled back to exactly.
+class LockstepSession {
+public:
+    bool start(World& w, const NetplayConfig& config, int localPort,
+               const std::string& peerHost, int peerPort, std::string& error);
+
+    UdpLink& link() { return udp; }
+
+    // Queues this tick's local input and steps the world one tick, first
+    // rolling back if the peer's input proved a guess wrong. Returns false
+    // without stepping while more than maxRollback ticks ahead of the
+    // peer; call again on the next frame.
+    bool advance(World& w, uint8_t localInput);
+
+    // Takes in the peer's input (rolling back if need be) and resends
+    // ours, without stepping; for when this side has stopped advancing
+    void sync(World& w);
+
+    int tick() const { return currentTick; }
+    NetplayStats stats() const;
+
+private:
+    void catchUp(World& w);
+    uint8_t remoteInputFor(int t) const;
+    uint8_t combinedInput(int t) const;
+    void stepTick(World& w, int t);
+    void receive();
+    void sendInputs();
+
+    NetplayConfig config;
+    UdpLink udp;
+
+    int currentTick = 0;                // next tick to simulate
+    std::vector<uint8_t> localInputs;   // by tick, inputDelay ahead
+    std::vector<uint8_t> remoteInputs;  // confirmed, by tick
+    std::vector<uint8_t> usedRemote;    // what each simulated tick used
+    int peerHas = 0;                    // our inputs the peer has acknowledged
+    int rollbackFrom = -1;              // earliest mispredicted tick
+
+    // World before each tick since the last confirmed one
+    RollbackRing snapshots;
+
+    NetplayStats counters;
+};
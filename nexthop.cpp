@@ -0,0 +1,203 @@
+// ============================================================================
+// nexthop.cpp
+// ALL-PAIRS NEXT-HOP TABLES FOR SCREEN-SIZED LEVELS
+// ============================================================================
+
+#include "nexthop.h"
+#include "jobs.h"
+#include <algorithm>
+
+// Up, down, left, right: the order ties between equally close neighbours
+// are broken in
+static const int STEP_DIRS[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+void NextHopTable::build(const PathGrid& grid) {
+    int cells = grid.width * grid.height;
+    std::vector<uint8_t> newWalls(cells);
+    for (int y = 0; y < grid.height; y++)
+        for (int x = 0; x < grid.width; x++)
+            newWalls[y * grid.width + x] = !grid.walkable(x, y);
+
+    // Same walls (a level reloaded, or a rollback): reopening cells one
+    // at a time gives the rows a fresh build would
+    if (ready() && grid.width == width && grid.height == height && newWalls == walls) {
+        for (int c = 0; c < cells; c++)
+            if (blocked[c] && !walls[c]) setBlocked(c % width, c / width, false);
+        return;
+    }
+
+    width = grid.width;
+    height = grid.height;
+    walls = std::move(newWalls);
+    blocked = walls;
+    dirty.assign(cells, 1);
+    entries.assign((size_t)cells * cells, UNREACHABLE);
+}
+
+void NextHopTable::clear() {
+    width = height = 0;
+    walls.clear();
+    blocked.clear();
+    dirty.clear();
+    entries.clear();
+}
+
+bool NextHopTable::isBlocked(int x, int y) const {
+    return x < 0 || x >= width || y < 0 || y >= height || blocked[y * width + x];
+}
+
+// The entry for an open cell `d` away from the goal: d, stepping to the
+// first neighbour that is d-1 away
+uint16_t NextHopTable::stepEntry(const uint16_t* r, int x, int y, int d) const {
+    for (int k = 0; k < 4; k++) {
+        int nx = x + STEP_DIRS[k][0], ny = y + STEP_DIRS[k][1];
+        if (!isBlocked(nx, ny) && dist(r[ny * width + nx]) == d - 1)
+            return (uint16_t)(d | k << 14);
+    }
+    return (uint16_t)d;     // the goal itself
+}
+
+void NextHopTable::setBlocked(int x, int y, bool isNowBlocked) {
+    if (!ready() || x < 0 || x >= width || y < 0 || y >= height) return;
+    int cell = y * width + x;
+    if (blocked[cell] == isNowBlocked) return;
+    blocked[cell] = isNowBlocked;
+
+    int cells = width * height;
+    for (int goal = 0; goal < cells; goal++) {
+        if (dirty[goal]) continue;
+        if (goal == cell) {
+            dirty[goal] = 1;
+            continue;
+        }
+        uint16_t* r = row(goal);
+
+        if (isNowBlocked) {
+            if (dist(r[cell]) == UNREACHABLE) continue;
+            // Only a cell some neighbour steps through changes other routes
+            bool onRoute = false;
+            for (int k = 0; k < 4 && !onRoute; k++) {
+                int nx = x + STEP_DIRS[k][0], ny = y + STEP_DIRS[k][1];
+                if (isBlocked(nx, ny)) continue;
+                uint16_t e = r[ny * width + nx];
+                onRoute = dist(e) != UNREACHABLE && dist(e) > 0 &&
+                          nx + STEP_DIRS[dir(e)][0] == x && ny + STEP_DIRS[dir(e)][1] == y;
+            }
+            if (onRoute) dirty[goal] = 1;
+            else r[cell] = UNREACHABLE;
+            continue;
+        }
+
+        // Freed: reachable through its nearest neighbour, and a shortcut
+        // if any other neighbour is more than two steps further out
+        int nearest = UNREACHABLE, farthest = 0;
+        for (int k = 0; k < 4; k++) {
+            int nx = x + STEP_DIRS[k][0], ny = y + STEP_DIRS[k][1];
+            if (isBlocked(nx, ny)) continue;
+            int d = dist(r[ny * width + nx]);
+            nearest = std::min(nearest, d);
+            farthest = std::max(farthest, d);
+        }
+        if (nearest == UNREACHABLE) continue;
+        int d = nearest + 1;
+        if (farthest > d + 1) {
+            dirty[goal] = 1;
+            continue;
+        }
+
+        r[cell] = stepEntry(r, x, y, d);
+        // Neighbours one further out may now step here first
+        for (int k = 0; k < 4; k++) {
+            int nx = x + STEP_DIRS[k][0], ny = y + STEP_DIRS[k][1];
+            if (!isBlocked(nx, ny) && dist(r[ny * width + nx]) == d + 1)
+                r[ny * width + nx] = stepEntry(r, nx, ny, d + 1);
+        }
+    }
+}
+
+void NextHopTable::walkRow(int goal) {
+    // Each worker walks its own rows, so each keeps its own frontier
+    static thread_local std::vector<int> frontier;
+
+    uint16_t* r = row(goal);
+    int cells = width * height;
+    std::fill(r, r + cells, (uint16_t)UNREACHABLE);
+    dirty[goal] = 0;
+    if (blocked[goal]) return;
+
+    frontier.clear();
+    frontier.push_back(goal);
+    r[goal] = 0;
+    for (size_t i = 0; i < frontier.size(); i++) {
+        int c = frontier[i];
+        int cx = c % width, cy = c / width;
+        for (const auto& s : STEP_DIRS) {
+            int nx = cx + s[0], ny = cy + s[1];
+            if (isBlocked(nx, ny)) continue;
+            int n = ny * width + nx;
+            if (dist(r[n]) != UNREACHABLE) continue;
+            r[n] = (uint16_t)(dist(r[c]) + 1);
+            frontier.push_back(n);
+        }
+    }
+
+    for (size_t i = 1; i < frontier.size(); i++) {
+        int c = frontier[i];
+        r[c] = stepEntry(r, c % width, c / width, dist(r[c]));
+    }
+}
+
+int NextHopTable::rebuildDirty(JobSystem* jobs) {
+    std::vector<int> rows;
+    for (int goal = 0; goal < (int)dirty.size(); goal++)
+        if (dirty[goal]) rows.push_back(goal);
+
+    if (jobs && rows.size() > 1) {
+        jobs->wait(jobs->addBatch((int)rows.size(), 16, [this, &rows](int i) { walkRow(rows[i]); }));
+    } else {
+        for (int goal : rows) walkRow(goal);
+    }
+    return (int)rows.size();
+}
+
+int NextHopTable::distance(int x, int y, int goalX, int goalY) const {
+    if (isBlocked(goalX, goalY) || x < 0 || x >= width || y < 0 || y >= height) return UNREACHABLE;
+    return dist(row(goalY * width + goalX)[y * width + x]);
+}
+
+bool NextHopTable::nextStep(int x, int y, int goalX, int goalY, int& nextX, int& nextY) const {
+    int d = distance(x, y, goalX, goalY);
+    if (d == UNREACHABLE || d == 0) return false;
+    uint16_t e = row(goalY * width + goalX)[y * width + x];
+    nextX = x + STEP_DIRS[dir(e)][0];
+    nextY = y + STEP_DIRS[dir(e)][1];
+    return true;
+}
+
+bool NextHopTable::findPath(int startX, int startY, int goalX, int goalY, GridPath& outPath) const {
+    outPath.clear();
+    int x = startX, y = startY;
+
+    // Like the searches, a start on a blocked cell (an enemy a pebble came
+    // to rest on) is left by its nearest open neighbour
+    if (isBlocked(x, y) && !(x == goalX && y == goalY)) {
+        int best = UNREACHABLE;
+        for (const auto& s : STEP_DIRS) {
+            int d = distance(startX + s[0], startY + s[1], goalX, goalY);
+            if (d < best && !isBlocked(startX + s[0], startY + s[1])) {
+                best = d;
+                x = startX + s[0];
+                y = startY + s[1];
+            }
+        }
+        if (best == UNREACHABLE) return false;
+        outPath.push_back({x, y});
+    }
+
+    int d = distance(x, y, goalX, goalY);
+    if (d == UNREACHABLE) return false;
+    outPath.reserve(outPath.size() + d);
+    while (nextStep(x, y, goalX, goalY, x, y))
+        outPath.push_back({x, y});
+    return true;
+}
@@ -0,0 +1,76 @@
+// ============================================================================
+// nexthop.h
+// ALL-PAIRS NEXT-HOP TABLES FOR SCREEN-SIZED LEVELS
+// ============================================================================
+//
+// For every goal cell, a row holding each cell's walking distance to that
+// goal and which neighbour to step to next. Following a path is then one
+// array read per cell, with no search at all. A 25x18 level takes 450
+// rows of 450 two-byte entries, about 400 KB.
+//
+// A row is a breadth-first walk out from its goal. The step stored for a
+// cell is the first neighbour, in a fixed order, that is one closer, so a
+// row depends only on which cells are blocked and not on how it was
+// brought up to date.
+//
+// setBlocked() fixes a row in place when the change cannot alter any other
+// cell's distance: a cell no route steps through became blocked, or a
+// freed cell opens no shortcut. Any other row is marked dirty, and
+// rebuildDirty() walks those again, spread over a JobSystem if given one.
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "pathfinding.h"
+
+class JobSystem;
+
+class NextHopTable {
+public:
+    static const int UNREACHABLE = 0x3fff;
+
+    // Takes the walls from `grid`, with nothing else blocked. Unless the
+    // walls are the ones already held, every row is marked dirty; if they
+    // are, the rows are kept and only cells blocked since are reopened.
+    void build(const PathGrid& grid);
+    void clear();
+    bool ready() const { return width > 0; }
+
+    void setBlocked(int x, int y, bool blocked);
+    bool isBlocked(int x, int y) const;
+
+    // Returns the number of rows walked again
+    int rebuildDirty(JobSystem* jobs = nullptr);
+
+    // Cells from (x, y) to (goalX, goalY) apart, or UNREACHABLE
+    int distance(int x, int y, int goalX, int goalY) const;
+
+    // The cell to step to from (x, y) on the way to (goalX, goalY); false
+    // if the goal cannot be reached or (x, y) is the goal
+    bool nextStep(int x, int y, int goalX, int goalY, int& nextX, int& nextY) const;
+
+    // Same output format as findPath. Must not be called while rows are
+    // dirty.
+    bool findPath(int startX, int startY, int goalX, int goalY, GridPath& outPath) const;
+
+    size_t bytes() const { return entries.size() * sizeof(uint16_t); }
+
+private:
+    // Entry: distance in the low 14 bits, step direction (index into
+    // STEP_DIRS in nexthop.cpp) in the top two
+    static int dist(uint16_t e) { return e & UNREACHABLE; }
+    static int dir(uint16_t e) { return e >> 14; }
+
+    uint16_t* row(int goal) { return entries.data() + (size_t)goal * width * height; }
+    const uint16_t* row(int goal) const { return entries.data() + (size_t)goal * width * height; }
+
+    void walkRow(int goal);
+    uint16_t stepEntry(const uint16_t* r, int x, int y, int d) const;
+
+    int width = 0, height = 0;
+    std::vector<uint8_t> walls;
+    std::vector<uint8_t> blocked;       // walls and setBlocked cells
+    std::vector<uint8_t> dirty;         // per goal row
+    std::vector<uint16_t> entries;      // width*height rows of width*height
+};
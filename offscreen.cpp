@@ -0,0 +1,232 @@
+// ============================================================================
+// offscreen.cpp
+// HEADLESS RENDER TARGET AND FRAME CAPTURES
+// ============================================================================
+
+#include "offscreen.h"
+#include <GL/glext.h>
+#include "stb_image.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __linux__
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static PFNGLGENFRAMEBUFFERSPROC genFramebuffers;
+static PFNGLBINDFRAMEBUFFERPROC bindFramebuffer;
+static PFNGLDELETEFRAMEBUFFERSPROC deleteFramebuffers;
+static PFNGLGENRENDERBUFFERSPROC genRenderbuffers;
+static PFNGLBINDRENDERBUFFERPROC bindRenderbuffer;
+static PFNGLDELETERENDERBUFFERSPROC deleteRenderbuffers;
+static PFNGLRENDERBUFFERSTORAGEPROC renderbufferStorage;
+static PFNGLFRAMEBUFFERRENDERBUFFERPROC framebufferRenderbuffer;
+static PFNGLCHECKFRAMEBUFFERSTATUSPROC checkFramebufferStatus;
+
+OffscreenTarget::~OffscreenTarget() {
+    if (!context) return;
+    EGLDisplay dpy = (EGLDisplay)display;
+    if (fbo) deleteFramebuffers(1, &fbo);
+    if (colorBuffer) deleteRenderbuffers(1, &colorBuffer);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(dpy, (EGLContext)context);
+    eglTerminate(dpy);
+}
+
+bool OffscreenTarget::create(int width, int height, std::string& error) {
+    // No window system at all: Mesa's surfaceless platform, falling back
+    // to whatever the default display is
+    EGLDisplay dpy = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (dpy == EGL_NO_DISPLAY) dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, nullptr, nullptr)) {
+        error = "no EGL display";
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        error = "EGL has no desktop OpenGL";
+        eglTerminate(dpy);
+        return false;
+    }
+
+    // The game draws with the fixed-function pipeline, so ask for a
+    // compatibility profile; 3.3 lets the instanced sprites run as well
+    const EGLint attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext ctx = eglCreateContext(dpy, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+    if (ctx == EGL_NO_CONTEXT)
+        ctx = eglCreateContext(dpy, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, nullptr);
+    if (ctx == EGL_NO_CONTEXT || !eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+        error = "cannot make a surfaceless GL context current";
+        if (ctx != EGL_NO_CONTEXT) eglDestroyContext(dpy, ctx);
+        eglTerminate(dpy);
+        return false;
+    }
+    display = dpy;
+    context = ctx;
+
+    genFramebuffers = (PFNGLGENFRAMEBUFFERSPROC)getGLProcAddress("glGenFramebuffers");
+    bindFramebuffer = (PFNGLBINDFRAMEBUFFERPROC)getGLProcAddress("glBindFramebuffer");
+    deleteFramebuffers = (PFNGLDELETEFRAMEBUFFERSPROC)getGLProcAddress("glDeleteFramebuffers");
+    genRenderbuffers = (PFNGLGENRENDERBUFFERSPROC)getGLProcAddress("glGenRenderbuffers");
+    bindRenderbuffer = (PFNGLBINDRENDERBUFFERPROC)getGLProcAddress("glBindRenderbuffer");
+    deleteRenderbuffers = (PFNGLDELETERENDERBUFFERSPROC)getGLProcAddress("glDeleteRenderbuffers");
+    renderbufferStorage = (PFNGLRENDERBUFFERSTORAGEPROC)getGLProcAddress("glRenderbufferStorage");
+    framebufferRenderbuffer = (PFNGLFRAMEBUFFERRENDERBUFFERPROC)getGLProcAddress("glFramebufferRenderbuffer");
+    checkFramebufferStatus = (PFNGLCHECKFRAMEBUFFERSTATUSPROC)getGLProcAddress("glCheckFramebufferStatus");
+    if (!genFramebuffers || !bindFramebuffer || !deleteFramebuffers || !genRenderbuffers ||
+        !bindRenderbuffer || !deleteRenderbuffers || !renderbufferStorage ||
+        !framebufferRenderbuffer || !checkFramebufferStatus) {
+        error = "GL has no framebuffer objects";
+        return false;
+    }
+
+    genRenderbuffers(1, &colorBuffer);
+    bindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    renderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    genFramebuffers(1, &fbo);
+    bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    framebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    if (checkFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        error = "offscreen framebuffer is incomplete";
+        return false;
+    }
+
+    w = width;
+    h = height;
+    glViewport(0, 0, w, h);
+    return true;
+}
+
+#else
+
+OffscreenTarget::~OffscreenTarget() {}
+
+bool OffscreenTarget::create(int, int, std::string& error) {
+    error = "offscreen rendering needs EGL (Linux only)";
+    return false;
+}
+
+#endif
+
+void OffscreenTarget::readPixels(std::vector<uint8_t>& rgba) {
+    rgba.resize((size_t)w * h * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+
+    // GL reads bottom row first
+    std::vector<uint8_t> row(w * 4);
+    for (int y = 0; y < h / 2; y++) {
+        uint8_t* a = &rgba[(size_t)y * w * 4];
+        uint8_t* b = &rgba[(size_t)(h - 1 - y) * w * 4];
+        memcpy(row.data(), a, w * 4);
+        memcpy(a, b, w * 4);
+        memcpy(b, row.data(), w * 4);
+    }
+}
+
+const char* OffscreenTarget::renderer() const {
+    const char* r = (const char*)glGetString(GL_RENDERER);
+    return r ? r : "?";
+}
+
+// ---------------------------------------------------------------------------
+// PNG
+// ---------------------------------------------------------------------------
+
+static uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void put32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(v >> 24);
+    out.push_back(v >> 16);
+    out.push_back(v >> 8);
+    out.push_back(v);
+}
+
+static void chunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data) {
+    put32(out, (uint32_t)data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    put32(out, crc32(&out[start], out.size() - start));
+}
+
+bool writePNG(const std::string& path, const uint8_t* rgba, int width, int height) {
+    // Scanlines, each behind a 0 (no filter) byte
+    const size_t stride = (size_t)width * 4;
+    std::vector<uint8_t> raw;
+    raw.reserve((stride + 1) * height);
+    for (int y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgba + y * stride, rgba + (y + 1) * stride);
+    }
+
+    // zlib stream of stored blocks (at most 65535 bytes each)
+    std::vector<uint8_t> z = {0x78, 0x01};
+    uint32_t a = 1, b = 0;
+    for (uint8_t v : raw) {
+        a = (a + v) % 65521;
+        b = (b + a) % 65521;
+    }
+    for (size_t pos = 0; pos < raw.size() || pos == 0;) {
+        size_t len = std::min<size_t>(65535, raw.size() - pos);
+        bool last = pos + len == raw.size();
+        z.push_back(last ? 1 : 0);
+        z.push_back(len & 0xFF);
+        z.push_back(len >> 8);
+        z.push_back(~len & 0xFF);
+        z.push_back((~len >> 8) & 0xFF);
+        z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + len);
+        pos += len;
+        if (last) break;
+    }
+    put32(z, (b << 16) | a);
+
+    std::vector<uint8_t> header;
+    put32(header, width);
+    put32(header, height);
+    header.insert(header.end(), {8, 6, 0, 0, 0});     // 8-bit RGBA, no interlace
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    chunk(png, "IHDR", header);
+    chunk(png, "IDAT", z);
+    chunk(png, "IEND", {});
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(png.data(), 1, png.size(), f) == png.size();
+    return fclose(f) == 0 && ok;
+}
+
+long comparePNG(const std::string& path, const uint8_t* rgba, int width, int height) {
+    int w, h, channels;
+    unsigned char* ref = stbi_load(path.c_str(), &w, &h, &channels, 4);
+    if (!ref) return -1;
+    if (w != width || h != height) {
+        stbi_image_free(ref);
+        return -1;
+    }
+
+    long differing = 0;
+    for (size_t i = 0; i < (size_t)w * h; i++)
+        if (memcmp(ref + i * 4, rgba + i * 4, 4) != 0) differing++;
+    stbi_image_free(ref);
+    return differing;
+}
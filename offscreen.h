@@ -0,0 +1,50 @@
+// ============================================================================
+// offscreen.h
+// HEADLESS RENDER TARGET AND FRAME CAPTURES
+// ============================================================================
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "utils.h"
+
+// A GL context with no window: an EGL surfaceless context (llvmpipe on a
+// machine without a GPU) rendering into a framebuffer object. Lets
+// display()'s drawing run on CI and be read back, timed and compared.
+// Only available where EGL is (Linux); elsewhere create() fails.
+class OffscreenTarget {
+public:
+    OffscreenTarget() = default;
+    ~OffscreenTarget();
+
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    // Makes a compatibility context current and binds a width x height
+    // RGBA framebuffer. False (with the reason in `error`) if not possible.
+    bool create(int width, int height, std::string& error);
+
+    int width() const { return w; }
+    int height() const { return h; }
+
+    // Waits for rendering and copies the frame out, top row first
+    void readPixels(std::vector<uint8_t>& rgba);
+
+    const char* renderer() const;
+
+private:
+    int w = 0, h = 0;
+    unsigned fbo = 0, colorBuffer = 0;
+    void* display = nullptr;
+    void* context = nullptr;
+};
+
+// Writes 8-bit RGBA pixels (top row first) as a PNG. Stored, uncompressed
+// deflate blocks: big files, but no zlib.
+bool writePNG(const std::string& path, const uint8_t* rgba, int width, int height);
+
+// Number of pixels that differ from the PNG at `path`, or -1 if it cannot
+// be read or is a different size
+long comparePNG(const std::string& path, const uint8_t* rgba, int width, int height);
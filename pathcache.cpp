@@ -0,0 +1,34 @@
+// ============================================================================
+// pathcache.cpp
+// SHARED PATH RESULTS, KEYED ON (START, GOAL, MAP VERSION)
+// ============================================================================
+
+#include "pathcache.h"
+
+void PathCache::setVersion(uint32_t version) {
+    if (version == currentVersion) return;
+    currentVersion = version;
+    entries.clear();
+}
+
+const PathCache::Entry* PathCache::lookup(int startX, int startY, int goalX, int goalY) {
+    auto it = entries.find(key(startX, startY, goalX, goalY));
+    if (it == entries.end()) {
+        missCount++;
+        return nullptr;
+    }
+    hitCount++;
+    return &it->second;
+}
+
+void PathCache::store(int startX, int startY, int goalX, int goalY, bool found, PathSpan path) {
+    if (entries.size() >= MAX_ENTRIES) entries.clear();
+
+    Entry& e = entries[key(startX, startY, goalX, goalY)];
+    e.found = found;
+    e.path = std::move(path);
+}
+
+void PathCache::clear() {
+    entries.clear();
+}
@@ -0,0 +1,70 @@
+// ============================================================================
+// pathcache.h
+// SHARED PATH RESULTS, KEYED ON (START, GOAL, MAP VERSION)
+// ============================================================================
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+#include "pathfinding.h"
+
+// Read-only view of a path held by the cache. Copying a span shares the
+// cells, so every enemy served from one search walks the same vector.
+class PathSpan {
+public:
+    PathSpan() = default;
+    explicit PathSpan(std::shared_ptr<const GridPath> cells) : cells(std::move(cells)) {}
+
+    bool empty() const { return !cells || cells->empty(); }
+    size_t size() const { return cells ? cells->size() : 0; }
+    const std::pair<int, int>& operator[](size_t i) const { return (*cells)[i]; }
+    void clear() { cells.reset(); }
+
+    // Whether both views are of the same search result
+    bool sharesCells(const PathSpan& o) const { return cells == o.cells; }
+
+private:
+    std::shared_ptr<const GridPath> cells;
+};
+
+// Search results for the current map version. The owner bumps its
+// version whenever walkability changes (level load, pebble moved);
+// setVersion() then drops everything searched against the old map.
+// Unreachable goals are cached too, since those are the searches that
+// run all the way to MAX_ITERATIONS.
+//
+// Not thread-safe: look up and store from one thread, search in between.
+class PathCache {
+public:
+    struct Entry {
+        bool found = false;
+        PathSpan path;
+    };
+
+    void setVersion(uint32_t version);
+    uint32_t version() const { return currentVersion; }
+
+    const Entry* lookup(int startX, int startY, int goalX, int goalY);
+    void store(int startX, int startY, int goalX, int goalY, bool found, PathSpan path);
+    void clear();
+
+    long long hits() const { return hitCount; }
+    long long misses() const { return missCount; }
+    size_t size() const { return entries.size(); }
+
+    // Within one version the goal (player cell) keeps moving, so stale
+    // goals pile up; past this many entries the table starts over
+    static const size_t MAX_ENTRIES = 512;
+
+private:
+    static uint64_t key(int startX, int startY, int goalX, int goalY) {
+        return ((uint64_t)(uint16_t)startX << 48) | ((uint64_t)(uint16_t)startY << 32) |
+               ((uint64_t)(uint16_t)goalX << 16) | (uint64_t)(uint16_t)goalY;
+    }
+
+    uint32_t currentVersion = 0;
+    std::unordered_map<uint64_t, Entry> entries;
+    long long hitCount = 0, missCount = 0;
+};
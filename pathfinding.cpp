@@ -0,0 +1,292 @@
+// ============================================================================
+// pathfinding.cpp
+// GRID SEARCHES FOR ENEMY AI
+// ============================================================================
+
+#include "pathfinding.h"
+#include <queue>
+#include <cstdlib>
+#include <functional>
+#include <algorithm>
+
+static float heuristic(int x1, int y1, int x2, int y2) {
+    return abs(x1 - x2) + abs(y1 - y2);
+}
+
+static bool checkEndpoints(const PathGrid& grid, int startX, int startY, int goalX, int goalY) {
+    if (startX == goalX && startY == goalY) return false;
+    if (startX < 0 || startX >= grid.width || startY < 0 || startY >= grid.height) return false;
+    if (goalX < 0 || goalX >= grid.width || goalY < 0 || goalY >= grid.height) return false;
+    if (!grid.walkable(goalX, goalY)) return false;
+    return true;
+}
+
+// ============================================================================
+// A*
+// ============================================================================
+
+void AStarSearch::begin(const PathGrid& searchGrid, int startX, int startY, int goalX, int goalY) {
+    grid = searchGrid;
+    this->goalX = goalX;
+    this->goalY = goalY;
+    openSet.clear();
+    result.clear();
+    searchStats = PathStats();
+    iterations = 0;
+    isFound = false;
+
+    if (!checkEndpoints(grid, startX, startY, goalX, goalY)) {
+        isFinished = true;
+        return;
+    }
+    isFinished = false;
+
+    const int W = grid.width, H = grid.height;
+    closedSet.assign(W * H, false);
+    cameFrom.assign(W * H, -1);
+    gScore.assign(W * H, 1e9f);
+
+    gScore[startY * W + startX] = 0;
+    openSet.push_back({startX, startY, 0, heuristic(startX, startY, goalX, goalY), -1, -1});
+}
+
+bool AStarSearch::step(int maxPops) {
+    if (isFinished) return true;
+
+    const int W = grid.width;
+    int dirs[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+    for (int pops = 0; pops < maxPops; pops++) {
+        if (openSet.empty() || iterations >= MAX_ITERATIONS) {
+            searchStats.capped = iterations >= MAX_ITERATIONS;
+            isFinished = true;
+            return true;
+        }
+
+        iterations++;
+        searchStats.pops = iterations;
+
+        std::pop_heap(openSet.begin(), openSet.end(), std::greater<AStarNode>());
+        AStarNode current = openSet.back();
+        openSet.pop_back();
+
+        if (closedSet[current.y * W + current.x]) continue;
+        closedSet[current.y * W + current.x] = true;
+        searchStats.expansions++;
+
+        if (current.parentX >= 0 && current.parentY >= 0) {
+            cameFrom[current.y * W + current.x] = current.parentY * W + current.parentX;
+        }
+
+        if (current.x == goalX && current.y == goalY) {
+            int c = goalY * W + goalX;
+            while (cameFrom[c] >= 0) {
+                result.push_back({c % W, c / W});
+                c = cameFrom[c];
+            }
+            std::reverse(result.begin(), result.end());
+
+            isFound = true;
+            isFinished = true;
+            return true;
+        }
+
+        for (int i = 0; i < 4; i++) {
+            int nx = current.x + dirs[i][0];
+            int ny = current.y + dirs[i][1];
+
+            if (!grid.walkable(nx, ny)) continue;
+            if (closedSet[ny * W + nx]) continue;
+
+            float tentativeG = current.g + 1.0f;
+
+            if (tentativeG < gScore[ny * W + nx]) {
+                gScore[ny * W + nx] = tentativeG;
+                float h = heuristic(nx, ny, goalX, goalY);
+                openSet.push_back({nx, ny, tentativeG, h, current.x, current.y});
+                std::push_heap(openSet.begin(), openSet.end(), std::greater<AStarNode>());
+            }
+        }
+    }
+
+    // Budget spent mid-search; an exhausted open list or cap is only
+    // noticed on the next pop, same as the unsliced loop
+    if (openSet.empty() || iterations >= MAX_ITERATIONS) {
+        searchStats.capped = iterations >= MAX_ITERATIONS;
+        isFinished = true;
+    }
+    return isFinished;
+}
+
+bool findPathAStar(const PathGrid& grid, int startX, int startY, int goalX, int goalY,
+                   GridPath& outPath, PathStats* stats)
+{
+    AStarSearch search;
+    search.begin(grid, startX, startY, goalX, goalY);
+    search.step(MAX_ITERATIONS);
+
+    outPath.swap(search.path());
+    if (stats) *stats = search.stats();
+    return search.found();
+}
+
+// ============================================================================
+// JUMP POINT SEARCH
+// ============================================================================
+//
+// Canonical 4-connected paths here run vertically first and turn
+// horizontal at any row, but only turn from horizontal back to vertical at
+// a jump point. So a vertical scan tries a horizontal scan on every row it
+// crosses, and a horizontal scan stops where a cell above or below opens up
+// whose neighbour behind it was a wall (a forced neighbour: no vertical run
+// could have reached it more cheaply).
+
+static bool horizontalForced(const PathGrid& g, int x, int y, int dx) {
+    return (g.walkable(x, y - 1) && !g.walkable(x - dx, y - 1)) ||
+           (g.walkable(x, y + 1) && !g.walkable(x - dx, y + 1));
+}
+
+static bool jumpHorizontal(const PathGrid& g, int x, int y, int dx, int goalX, int goalY, int& outX) {
+    for (;;) {
+        x += dx;
+        if (!g.walkable(x, y)) return false;
+        if ((x == goalX && y == goalY) || horizontalForced(g, x, y, dx)) {
+            outX = x;
+            return true;
+        }
+    }
+}
+
+static bool jumpVertical(const PathGrid& g, int x, int y, int dy, int goalX, int goalY, int& outY) {
+    for (;;) {
+        y += dy;
+        if (!g.walkable(x, y)) return false;
+
+        int hx;
+        if ((x == goalX && y == goalY) ||
+            jumpHorizontal(g, x, y, -1, goalX, goalY, hx) ||
+            jumpHorizontal(g, x, y,  1, goalX, goalY, hx)) {
+            outY = y;
+            return true;
+        }
+    }
+}
+
+static int sign(int v) { return (v > 0) - (v < 0); }
+
+bool findPathJPS(const PathGrid& grid, int startX, int startY, int goalX, int goalY,
+                 GridPath& outPath, PathStats* stats, FrameArena* scratch)
+{
+    outPath.clear();
+
+    if (!checkEndpoints(grid, startX, startY, goalX, goalY)) return false;
+
+    const int W = grid.width, H = grid.height;
+
+    ArenaAllocator<int> alloc(scratch);
+    FrameVector<AStarNode> openStorage(alloc);
+    std::priority_queue<AStarNode, FrameVector<AStarNode>, std::greater<AStarNode>> openSet(
+        std::greater<AStarNode>(), std::move(openStorage));
+    std::vector<bool, ArenaAllocator<bool>> closedSet(W * H, false, alloc);
+    FrameVector<int> parent(W * H, -1, alloc);
+    FrameVector<float> gScore(W * H, 1e9f, alloc);
+
+    gScore[startY * W + startX] = 0;
+    openSet.push({startX, startY, 0, heuristic(startX, startY, goalX, goalY), -1, -1});
+
+    int iterations = 0;
+
+    while (!openSet.empty() && iterations < MAX_ITERATIONS) {
+        iterations++;
+        if (stats) stats->pops = iterations;
+
+        AStarNode current = openSet.top();
+        openSet.pop();
+
+        int ci = current.y * W + current.x;
+        if (closedSet[ci]) continue;
+        closedSet[ci] = true;
+        if (stats) stats->expansions++;
+
+        if (current.parentX >= 0)
+            parent[ci] = current.parentY * W + current.parentX;
+
+        if (current.x == goalX && current.y == goalY) {
+            // Walk the jump points back, filling in the straight runs
+            int cx = goalX, cy = goalY;
+            while (parent[cy * W + cx] >= 0) {
+                int p = parent[cy * W + cx];
+                int px = p % W, py = p / W;
+                int sx = sign(px - cx), sy = sign(py - cy);
+                while (cx != px || cy != py) {
+                    outPath.push_back({cx, cy});
+                    cx += sx;
+                    cy += sy;
+                }
+            }
+            std::reverse(outPath.begin(), outPath.end());
+
+            return true;
+        }
+
+        // Directions worth scanning from here, pruned by how we arrived
+        int dirs[4][2];
+        int numDirs = 0;
+        if (current.parentX < 0) {
+            int all[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+            for (auto& d : all) { dirs[numDirs][0] = d[0]; dirs[numDirs][1] = d[1]; numDirs++; }
+        } else {
+            int dx = sign(current.x - current.parentX);
+            int dy = sign(current.y - current.parentY);
+            if (dx != 0) {
+                dirs[numDirs][0] = dx; dirs[numDirs][1] = 0; numDirs++;
+                for (int vy = -1; vy <= 1; vy += 2) {
+                    if (grid.walkable(current.x, current.y + vy) &&
+                        !grid.walkable(current.x - dx, current.y + vy)) {
+                        dirs[numDirs][0] = 0; dirs[numDirs][1] = vy; numDirs++;
+                    }
+                }
+            } else {
+                dirs[numDirs][0] = 0;  dirs[numDirs][1] = dy; numDirs++;
+                dirs[numDirs][0] = -1; dirs[numDirs][1] = 0;  numDirs++;
+                dirs[numDirs][0] = 1;  dirs[numDirs][1] = 0;  numDirs++;
+            }
+        }
+
+        for (int i = 0; i < numDirs; i++) {
+            int nx = current.x, ny = current.y;
+            bool found = dirs[i][0] != 0
+                ? jumpHorizontal(grid, current.x, current.y, dirs[i][0], goalX, goalY, nx)
+                : jumpVertical(grid, current.x, current.y, dirs[i][1], goalX, goalY, ny);
+            if (!found) continue;
+            if (closedSet[ny * W + nx]) continue;
+
+            float tentativeG = current.g + abs(nx - current.x) + abs(ny - current.y);
+
+            if (tentativeG < gScore[ny * W + nx]) {
+                gScore[ny * W + nx] = tentativeG;
+                float h = heuristic(nx, ny, goalX, goalY);
+                openSet.push({nx, ny, tentativeG, h, current.x, current.y});
+            }
+        }
+    }
+
+    if (stats) stats->capped = iterations >= MAX_ITERATIONS;
+    return false;
+}
+
+// ============================================================================
+// DISPATCH
+// ============================================================================
+
+bool findPath(PathMode mode, const PathGrid& grid, int startX, int startY, int goalX, int goalY,
+              GridPath& outPath, PathStats* stats, FrameArena* scratch)
+{
+    switch (mode) {
+        case PATH_JPS:
+            return findPathJPS(grid, startX, startY, goalX, goalY, outPath, stats, scratch);
+        case PATH_ASTAR:
+        default:
+            return findPathAStar(grid, startX, startY, goalX, goalY, outPath, stats);
+    }
+}
@@ -0,0 +1,96 @@
+// ============================================================================
+// pathfinding.h
+// GRID SEARCHES FOR ENEMY AI
+// ============================================================================
+
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <functional>
+#include <utility>
+#include "Levels.h"
+#include "arena.h"
+
+typedef std::vector<std::pair<int, int>> GridPath;
+
+// Read-only walkability view over a row-major tile array (1 = wall)
+struct PathGrid {
+    int width = 0, height = 0;
+    const int* tiles = nullptr;
+
+    bool walkable(int x, int y) const {
+        return x >= 0 && x < width && y >= 0 && y < height && tiles[y * width + x] != 1;
+    }
+};
+
+struct PathStats {
+    int expansions = 0;     // nodes taken off the open list and closed
+    int pops = 0;           // open list pops, counted against MAX_ITERATIONS
+    bool capped = false;    // gave up at MAX_ITERATIONS
+};
+
+// Both searches are 4-connected, return the cells after start up to and
+// including goal, and give up after MAX_ITERATIONS open-list pops.
+const int MAX_ITERATIONS = 500;
+
+bool findPathAStar(const PathGrid& grid, int startX, int startY, int goalX, int goalY,
+                   GridPath& outPath, PathStats* stats = nullptr);
+
+struct AStarNode {
+    int x, y;
+    float g;
+    float h;
+    int parentX, parentY;
+
+    float f() const { return g + h; }
+
+    bool operator>(const AStarNode& other) const {
+        return f() > other.f();
+    }
+};
+
+// findPathAStar as an object that can stop after a number of open-list
+// pops and carry on later, so a long search can be spread over several
+// ticks. Run to completion it expands exactly what findPathAStar does.
+// The grid's tiles must stay put between begin() and the last step().
+// begin() keeps the buffers of the previous search, so reusing one object
+// stops allocating once it has seen the grid size.
+class AStarSearch {
+public:
+    void begin(const PathGrid& grid, int startX, int startY, int goalX, int goalY);
+
+    // Up to maxPops more pops; returns true once the search has finished
+    bool step(int maxPops);
+
+    bool finished() const { return isFinished; }
+    bool found() const { return isFound; }
+    GridPath& path() { return result; }
+    const PathStats& stats() const { return searchStats; }
+
+private:
+    PathGrid grid;
+    int goalX = 0, goalY = 0;
+    std::vector<AStarNode> openSet;     // min-heap on f, as priority_queue keeps it
+    std::vector<bool> closedSet;
+    std::vector<int> cameFrom;
+    std::vector<float> gScore;
+    int iterations = 0;
+    bool isFinished = true;
+    bool isFound = false;
+    GridPath result;
+    PathStats searchStats;
+};
+
+// Jump Point Search for 4-connected grids. Only jump points go on the open
+// list: straight runs across open floor are scanned, not queued, so open
+// levels expand a handful of nodes instead of whole plateaus of equal f.
+// The returned path is expanded back to single cell steps. Its working
+// sets come from `scratch` when given, otherwise from the heap.
+bool findPathJPS(const PathGrid& grid, int startX, int startY, int goalX, int goalY,
+                 GridPath& outPath, PathStats* stats = nullptr, FrameArena* scratch = nullptr);
+
+// PATH_INCREMENTAL and PATH_HIERARCHICAL keep state between queries (see
+// incremental.h, hpa.h); here they fall back to A*
+bool findPath(PathMode mode, const PathGrid& grid, int startX, int startY, int goalX, int goalY,
+              GridPath& outPath, PathStats* stats = nullptr, FrameArena* scratch = nullptr);
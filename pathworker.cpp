@@ -0,0 +1,68 @@
+// ============================================================================
+// pathworker.cpp
+// BACKGROUND PATH SEARCH THREAD
+// ============================================================================
+
+#include "pathworker.h"
+
+PathWorker::PathWorker() {
+    thread = std::thread(&PathWorker::run, this);
+}
+
+PathWorker::~PathWorker() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        quitting = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+bool PathWorker::post(PathJob job) {
+    if (inFlight() >= CAPACITY) return false;
+    if (!jobs.push(std::move(job))) return false;
+    posted++;
+
+    // Lock so the notify cannot slip in between the worker's empty check
+    // and its wait
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    wake.notify_one();
+    return true;
+}
+
+bool PathWorker::poll(PathResult& out) {
+    if (!results.pop(out)) return false;
+    received++;
+    return true;
+}
+
+void PathWorker::run() {
+    for (;;) {
+        PathJob job;
+        if (!jobs.pop(job)) {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return quitting || !jobs.empty(); });
+            if (quitting) return;
+            continue;
+        }
+
+        PathResult result;
+        result.id = job.id;
+        GridPath cells;
+        if (job.snapshot->mode == PATH_ASTAR) {
+            search.begin(job.snapshot->grid(), job.fromX, job.fromY, job.toX, job.toY);
+            search.step(MAX_ITERATIONS);
+            result.found = search.found();
+            cells.swap(search.path());
+        } else {
+            result.found = findPath(job.snapshot->mode, job.snapshot->grid(),
+                                    job.fromX, job.fromY, job.toX, job.toY, cells, nullptr, &scratch);
+            scratch.reset();
+        }
+        if (result.found)
+            result.path = PathSpan(std::make_shared<const GridPath>(std::move(cells)));
+
+        // Cannot fail: no more than CAPACITY jobs are ever in flight
+        results.push(std::move(result));
+    }
+}
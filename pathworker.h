@@ -0,0 +1,106 @@
+// ============================================================================
+// pathworker.h
+// BACKGROUND PATH SEARCH THREAD
+// ============================================================================
+
+#pragma once
+
+#include <array>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include "pathfinding.h"
+#include "pathcache.h"
+
+// Bounded single-producer / single-consumer ring. push() only from the
+// producer thread, pop() only from the consumer; no locks either side.
+template <typename T, size_t N>
+class SpscRing {
+public:
+    bool push(T value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) return false;
+        slots[t % N] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& out) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        out = std::move(slots[h % N]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, N> slots;
+    std::atomic<size_t> head{0}, tail{0};
+};
+
+// Immutable copy of a level's walls. Jobs hold it by shared_ptr, so the
+// worker can finish a search after the simulation has moved on.
+struct PathSnapshot {
+    uint32_t version = 0;
+    PathMode mode = PATH_ASTAR;
+    int width = 0, height = 0;
+    std::vector<int> tiles;
+
+    PathGrid grid() const { return PathGrid{width, height, tiles.data()}; }
+};
+
+struct PathJob {
+    uint32_t id = 0;
+    int fromX = 0, fromY = 0;
+    int toX = 0, toY = 0;
+    std::shared_ptr<const PathSnapshot> snapshot;
+};
+
+struct PathResult {
+    uint32_t id = 0;
+    bool found = false;
+    PathSpan path;
+};
+
+// One thread running findPath() on posted jobs, in order. Serves a single
+// World: post() and poll() must come from the same (simulation) thread.
+// At most CAPACITY jobs are in flight, so the result ring never fills.
+class PathWorker {
+public:
+    static const size_t CAPACITY = 256;
+
+    PathWorker();
+    ~PathWorker();
+
+    PathWorker(const PathWorker&) = delete;
+    PathWorker& operator=(const PathWorker&) = delete;
+
+    // False when CAPACITY jobs are already in flight; try again next tick
+    bool post(PathJob job);
+    bool poll(PathResult& out);
+
+    size_t inFlight() const { return posted - received; }
+
+private:
+    void run();
+
+    // Worker-thread search state, reused from job to job
+    AStarSearch search;
+    FrameArena scratch;
+
+    SpscRing<PathJob, CAPACITY> jobs;
+    SpscRing<PathResult, CAPACITY> results;
+    size_t posted = 0, received = 0;
+
+    std::thread thread;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    bool quitting = false;
+};
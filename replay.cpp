@@ -0,0 +1,347 @@
+// ============================================================================
+// replay.cpp
+// PER-TICK STATE HASHES, INPUT RECORDING AND DIVERGENCE CHECKS
+// ============================================================================
+
+#include "replay.h"
+#include "world.h"
+#include "levelfile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+static const char* const FIELD_NAMES[NUM_HASH_FIELDS] = {
+    "player", "enemies", "pebbles", "items", "fire",
+};
+
+const char* hashFieldName(int field) {
+    return field >= 0 && field < NUM_HASH_FIELDS ? FIELD_NAMES[field] : "?";
+}
+
+bool StateHash::operator==(const StateHash& o) const {
+    return firstDifference(o) < 0;
+}
+
+int StateHash::firstDifference(const StateHash& o) const {
+    for (int i = 0; i < NUM_HASH_FIELDS; i++)
+        if (fields[i] != o.fields[i]) return i;
+    return -1;
+}
+
+// ----------------------------------------------------------------------------
+// Hashing
+// ----------------------------------------------------------------------------
+
+// 64-bit FNV-1a, fed one scalar at a time so struct padding never counts
+struct Hasher {
+    uint64_t h = 14695981039346656037ull;
+
+    void bytes(const void* p, size_t n) {
+        const unsigned char* b = (const unsigned char*)p;
+        for (size_t i = 0; i < n; i++) {
+            h ^= b[i];
+            h *= 1099511628211ull;
+        }
+    }
+
+    template <typename T>
+    void add(T v) { bytes(&v, sizeof(v)); }
+
+    void tex(const Texture* t) { add(sharedTextureIndex(t)); }
+};
+
+StateHash hashState(const World& w) {
+    StateHash out;
+
+    Hasher player;
+    player.add(w.currLevel);
+    player.add(w.player.x);
+    player.add(w.player.y);
+    player.tex(w.player.tex);
+    player.add(w.justTeleported);
+    player.add(w.spawnPortalID);
+    if (w.hasPartner) {
+        player.add(w.partner.x);
+        player.add(w.partner.y);
+    }
+    out.fields[HASH_PLAYER] = player.h;
+
+    Hasher enemies;
+    enemies.add(w.enemies.size());
+    for (size_t i = 0; i < w.enemies.size(); i++) {
+        const Enemy& e = w.enemies[i];
+        enemies.add(e.x);
+        enemies.add(e.y);
+        enemies.add(e.speed);
+        enemies.add(e.angle);
+        enemies.tex(e.tex);
+        enemies.add(e.alive);
+
+        if (i >= w.enemyPaths.size()) continue;
+        const EnemyPath& p = w.enemyPaths[i];
+        enemies.add(p.isMoving);
+        enemies.add(p.currentStep);
+        enemies.add(p.framesUntilRecalc);
+        enemies.add(p.moveProgress);
+        enemies.add(p.targetGridX);
+        enemies.add(p.targetGridY);
+        enemies.add(p.awaitingPath);
+        enemies.add(p.path.size());
+        for (size_t k = 0; k < p.path.size(); k++) {
+            enemies.add(p.path[k].first);
+            enemies.add(p.path[k].second);
+        }
+
+        // Only hashed when used, so older recordings still match
+        if (w.lineOfSight) {
+            enemies.add(p.chasing);
+            enemies.add(p.lastSeenX);
+            enemies.add(p.lastSeenY);
+            enemies.add(p.patrolX);
+            enemies.add(p.patrolY);
+        }
+    }
+    out.fields[HASH_ENEMIES] = enemies.h;
+
+    Hasher pebbles;
+    pebbles.add(w.pebbles.size());
+    for (const Pebble& p : w.pebbles) {
+        pebbles.add(p.x);
+        pebbles.add(p.y);
+        pebbles.add(p.isBeingPushed);
+        pebbles.add(p.isBeingPushed ? p.pushStartTime : 0);
+        pebbles.add(p.isSliding);
+        pebbles.add(p.targetGridX);
+        pebbles.add(p.targetGridY);
+        pebbles.add(p.slideProgress);
+    }
+    out.fields[HASH_PEBBLES] = pebbles.h;
+
+    Hasher items;
+    items.add(w.items.size());
+    for (const Sprite& s : w.items) {
+        items.add(s.x);
+        items.add(s.y);
+        items.tex(s.tex);
+    }
+    items.add(w.berries.size());
+    for (const Berry& b : w.berries) {
+        items.add(b.gridX);
+        items.add(b.gridY);
+        items.add(b.berryID);
+    }
+    for (int i = 0; i < NUM_ITEM_TYPES; i++)
+        items.add(w.inventory.count((ItemId)i));
+    out.fields[HASH_ITEMS] = items.h;
+
+    Hasher fire;
+    fire.add(w.nextBurnMs);
+    fire.add(w.fires.size());
+    for (const auto& f : w.fires) {
+        fire.add(f[0]);
+        fire.add(f[1]);
+    }
+    for (const Sprite& s : w.items)
+        if (s.tex == &flameTex) fire.add(s.burnEndTime);
+    fire.add(w.spreadQueue.size());
+    for (const BurnCheckEvent& e : w.spreadQueue) {
+        fire.add(e.gridX);
+        fire.add(e.gridY);
+    }
+    out.fields[HASH_FIRE] = fire.h;
+
+    return out;
+}
+
+uint64_t hashLevels(const LevelData* levels, int count) {
+    Hasher h;
+    for (int i = 0; i < count; i++) {
+        std::string text = levelToText(levels[i]);
+        h.bytes(text.data(), text.size());
+    }
+    return h.h;
+}
+
+// ----------------------------------------------------------------------------
+// Log file
+// ----------------------------------------------------------------------------
+
+bool ReplayLog::save(const std::string& path) const {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) return false;
+
+    fprintf(f, "roach-replay 1\nlevel %d\ntick-ms %d\nlevels %016llx\nchase %s %d\nsight %d\nhops %d\n",
+            startLevel, tickMs, (unsigned long long)levelsHash,
+            chaseMode == CHASE_INTERCEPT ? "intercept" : "player", interceptHorizons,
+            lineOfSight ? 1 : 0, nextHopTables ? 1 : 0);
+
+    size_t next = 0;
+    for (size_t t = 0; t < ticks.size(); t++) {
+        for (; next < actions.size() && actions[next].tick == (int)t; next++)
+            fprintf(f, "a %d %d %d\n", actions[next].kind, actions[next].gx, actions[next].gy);
+        fprintf(f, "t %d", ticks[t].input);
+        for (int i = 0; i < NUM_HASH_FIELDS; i++)
+            fprintf(f, " %016llx", (unsigned long long)ticks[t].hash.fields[i]);
+        fprintf(f, "\n");
+    }
+
+    bool ok = !ferror(f);
+    return fclose(f) == 0 && ok;
+}
+
+bool ReplayLog::load(const std::string& path, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    ReplayLog loaded;
+    std::string line;
+    int lineNo = 0;
+    bool sawHeader = false;
+    while (std::getline(in, line)) {
+        lineNo++;
+        std::istringstream words(line);
+        std::string key;
+        if (!(words >> key) || key[0] == '#') continue;
+
+        bool ok = true;
+        if (key == "roach-replay") {
+            int version = 0;
+            ok = (words >> version) && version == 1;
+            sawHeader = true;
+        } else if (key == "level") {
+            ok = (bool)(words >> loaded.startLevel) && loaded.startLevel >= 0 && loaded.startLevel < NUM_LEVELS;
+        } else if (key == "tick-ms") {
+            ok = (bool)(words >> loaded.tickMs) && loaded.tickMs > 0;
+        } else if (key == "levels") {
+            ok = (bool)(words >> std::hex >> loaded.levelsHash);
+        } else if (key == "chase") {
+            std::string mode;
+            ok = (bool)(words >> mode >> loaded.interceptHorizons) && (mode == "player" || mode == "intercept");
+            loaded.chaseMode = mode == "intercept" ? CHASE_INTERCEPT : CHASE_PLAYER;
+        } else if (key == "sight") {
+            int on = 0;
+            ok = (bool)(words >> on) && (on == 0 || on == 1);
+            loaded.lineOfSight = on == 1;
+        } else if (key == "hops") {
+            int on = 0;
+            ok = (bool)(words >> on) && (on == 0 || on == 1);
+            loaded.nextHopTables = on == 1;
+        } else if (key == "a") {
+            ReplayAction a;
+            a.tick = (int)loaded.ticks.size();
+            ok = (bool)(words >> a.kind >> a.gx >> a.gy);
+            if (ok) loaded.actions.push_back(a);
+        } else if (key == "t") {
+            ReplayTick t;
+            int input;
+            ok = (bool)(words >> input) && input >= 0 && input <= 0xff;
+            t.input = (uint8_t)input;
+            words >> std::hex;
+            for (int i = 0; ok && i < NUM_HASH_FIELDS; i++)
+                ok = (bool)(words >> t.hash.fields[i]);
+            if (ok) loaded.ticks.push_back(t);
+        } else {
+            ok = false;
+        }
+
+        if (!ok || (!sawHeader && key != "roach-replay")) {
+            error = "line " + std::to_string(lineNo) + ": " + (sawHeader ? "bad " + key : "not a replay file");
+            return false;
+        }
+    }
+
+    if (!sawHeader) {
+        error = "not a replay file";
+        return false;
+    }
+    *this = std::move(loaded);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Recording and replay
+// ----------------------------------------------------------------------------
+
+void ReplayRecorder::start(const World& w, int tickMs) {
+    log = ReplayLog();
+    log.startLevel = w.currLevel;
+    log.tickMs = tickMs;
+    log.levelsHash = hashLevels(w.levels, NUM_LEVELS);
+    log.chaseMode = w.chaseMode;
+    log.interceptHorizons = w.interceptHorizons;
+    log.lineOfSight = w.lineOfSight;
+    log.nextHopTables = w.nextHopTables;
+    recording = true;
+}
+
+void ReplayRecorder::action(int kind, int gx, int gy) {
+    if (recording) log.actions.push_back({(int)log.ticks.size(), kind, gx, gy});
+}
+
+void ReplayRecorder::tick(const World& w, uint8_t input) {
+    if (recording) log.ticks.push_back({input, hashState(w)});
+}
+
+bool ReplayRecorder::stop(const std::string& path) {
+    if (!recording) return true;
+    recording = false;
+    // Tool uses after the last tick never affected a recorded hash
+    while (!log.actions.empty() && log.actions.back().tick >= (int)log.ticks.size())
+        log.actions.pop_back();
+    return log.save(path);
+}
+
+ReplayResult replay(World& w, const ReplayLog& log, ReplayLog* rerecorded) {
+    ReplayResult result;
+
+    w.chaseMode = (ChaseMode)log.chaseMode;
+    if (log.interceptHorizons > 0) w.interceptHorizons = log.interceptHorizons;
+    w.lineOfSight = log.lineOfSight;
+    w.nextHopTables = log.nextHopTables;
+    w.loadLevel(log.startLevel);
+    if (rerecorded) {
+        *rerecorded = ReplayLog();
+        rerecorded->startLevel = log.startLevel;
+        rerecorded->tickMs = log.tickMs;
+        rerecorded->levelsHash = hashLevels(w.levels, NUM_LEVELS);
+        rerecorded->chaseMode = w.chaseMode;
+        rerecorded->interceptHorizons = w.interceptHorizons;
+        rerecorded->lineOfSight = w.lineOfSight;
+        rerecorded->nextHopTables = w.nextHopTables;
+        rerecorded->actions = log.actions;
+    }
+
+    long long clockMs = 0;
+    size_t next = 0;
+    for (size_t t = 0; t < log.ticks.size(); t++) {
+        for (; next < log.actions.size() && log.actions[next].tick == (int)t; next++) {
+            const ReplayAction& a = log.actions[next];
+            if (a.kind == REPLAY_CLEAR_ITEMS) {
+                w.clearItems();
+            } else {
+                w.placeMode = a.kind;
+                w.useTool(a.gx, a.gy);
+            }
+        }
+
+        clockMs += log.tickMs;
+        w.step(log.ticks[t].input, clockMs);
+        StateHash h = hashState(w);
+        result.ticks++;
+        if (rerecorded) rerecorded->ticks.push_back({log.ticks[t].input, h});
+
+        int field = h.firstDifference(log.ticks[t].hash);
+        if (field >= 0) {
+            result.divergedTick = (int)t;
+            result.divergedField = field;
+            result.expected = log.ticks[t].hash;
+            result.actual = h;
+            break;
+        }
+    }
+    return result;
+}
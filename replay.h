@@ -0,0 +1,126 @@
+// ============================================================================
+// replay.h
+// PER-TICK STATE HASHES, INPUT RECORDING AND DIVERGENCE CHECKS
+// ============================================================================
+//
+//   roach-replay 1
+//   level 0                       level the recording starts on
+//   tick-ms 16                    clock advance per tick
+//   levels 3f2a...                hashLevels() of the level definitions
+//   chase intercept 5             World::chaseMode (player / intercept) and
+//                                 interceptHorizons; chase player if absent
+//   sight 1                       World::lineOfSight; 0 if absent
+//   hops 1                        World::nextHopTables; 0 if absent
+//   a 1 12 7                      tool use (placeMode, or 0 = clear items)
+//                                 at a cell, before the next tick
+//   t 5 <hash> <hash> ...         a tick: input bits, then one hash per
+//                                 HashField after the step
+//
+// A recording made by one build and replayed by another shows whether a
+// change kept the simulation identical, and if not, the first tick and
+// part of the state where they differ.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Levels.h"
+
+struct World;
+
+// The parts of the state hashed separately, so a mismatch says where
+enum HashField {
+    HASH_PLAYER,        // both players, level, teleport state
+    HASH_ENEMIES,       // bodies plus path following state
+    HASH_PEBBLES,
+    HASH_ITEMS,         // placed items, berries, inventory
+    HASH_FIRE,          // fire cells, burn timers, spread queue
+    NUM_HASH_FIELDS
+};
+
+const char* hashFieldName(int field);
+
+struct StateHash {
+    uint64_t fields[NUM_HASH_FIELDS] = {};
+
+    bool operator==(const StateHash& o) const;
+    bool operator!=(const StateHash& o) const { return !(*this == o); }
+
+    // First field that differs from `o`, or -1
+    int firstDifference(const StateHash& o) const;
+};
+
+// Hashes floats by bit pattern and textures by which shared texture they
+// are, so the result is the same in any build that simulates the same
+// thing, wherever its globals end up in memory
+StateHash hashState(const World& w);
+
+// Hash of the level definitions in their text form; a replay against
+// different levels is refused instead of reported as a divergence
+uint64_t hashLevels(const LevelData* levels, int count);
+
+// Tool use; placeMode 1 = place, 2 = burn, as in World::useTool
+const int REPLAY_CLEAR_ITEMS = 0;
+
+struct ReplayAction {
+    int tick;           // applied before this tick is stepped
+    int kind;           // placeMode, or REPLAY_CLEAR_ITEMS
+    int gx, gy;
+};
+
+struct ReplayTick {
+    uint8_t input;
+    StateHash hash;
+};
+
+struct ReplayLog {
+    int startLevel = 0;
+    int tickMs = 16;
+    uint64_t levelsHash = 0;
+    int chaseMode = 0;                      // ChaseMode
+    int interceptHorizons = 0;
+    bool lineOfSight = false;
+    bool nextHopTables = false;
+    std::vector<ReplayAction> actions;      // in tick order
+    std::vector<ReplayTick> ticks;
+
+    bool save(const std::string& path) const;
+
+    // On failure describes the first bad line in `error`
+    bool load(const std::string& path, std::string& error);
+};
+
+// Writes a recording while the game is played. The world must step with
+// an in-tick path budget of steps only (no PathWorker, no maxMicros), or
+// the recording will not replay.
+class ReplayRecorder {
+public:
+    void start(const World& w, int tickMs);
+    bool active() const { return recording; }
+
+    // Call just before World::useTool / clearItems
+    void action(int kind, int gx, int gy);
+
+    // Call after each World::step with the input it was given
+    void tick(const World& w, uint8_t input);
+
+    // Saves and stops; false if the file could not be written
+    bool stop(const std::string& path);
+
+private:
+    ReplayLog log;
+    bool recording = false;
+};
+
+struct ReplayResult {
+    int ticks = 0;              // ticks replayed
+    int divergedTick = -1;      // first tick whose hash differs, or -1
+    int divergedField = -1;     // first HashField that differs there
+    StateHash expected, actual;
+};
+
+// Replays `log` on `w` from the start of its level and compares each tick
+// with the recorded hashes, stopping at the first difference. The hashes
+// this build produced go to `rerecorded` if given, for a later replay.
+ReplayResult replay(World& w, const ReplayLog& log, ReplayLog* rerecorded = nullptr);
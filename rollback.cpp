@@ -0,0 +1,326 @@
+// ============================================================================
+// rollback.cpp
+// FIXED-SIZE WORLD STATE FOR ROLLBACK AND LOOKAHEAD
+// ============================================================================
+
+#include "rollback.h"
+#include <memory>
+
+// One bit pair per step, in this order
+static const int STEP_DIRS[4][2] = {{0, -1}, {0, 1}, {-1, 0}, {1, 0}};
+
+static int pathBytesFor(size_t cells) {
+    return cells == 0 ? 0 : 2 + ((int)cells - 1 + 3) / 4;
+}
+
+// Paths already written (or read) in this save (or restore), so enemies
+// that shared one search result still share one copy
+const int MAX_STATE_PATHS = 2 * ROLLBACK_MAX_ENEMIES;
+
+struct SavedPaths {
+    const PathSpan* spans[MAX_STATE_PATHS];
+    RollbackState::PathRef refs[MAX_STATE_PATHS];
+    int count = 0;
+};
+
+struct LoadedPaths {
+    uint16_t offsets[MAX_STATE_PATHS];
+    PathSpan spans[MAX_STATE_PATHS];
+    int count = 0;
+    size_t nextStorage = 0;     // first World::restoredPaths entry not yet looked at
+};
+
+// Appends `path` to the state's path bytes, or points at an earlier copy
+// of the same search result
+static bool savePath(RollbackState& s, const PathSpan& path, RollbackState::PathRef& ref, SavedPaths& saved) {
+    ref = {0, 0};
+    if (path.empty()) return true;
+    for (int i = 0; i < saved.count; i++)
+        if (saved.spans[i]->sharesCells(path)) {
+            ref = saved.refs[i];
+            return true;
+        }
+
+    int bytes = pathBytesFor(path.size());
+    if (s.numPathBytes + bytes > ROLLBACK_MAX_PATH_BYTES || path.size() > 0xffff) return false;
+
+    uint8_t* out = s.pathBytes + s.numPathBytes;
+    out[0] = (uint8_t)path[0].first;
+    out[1] = (uint8_t)path[0].second;
+    for (int b = 2; b < bytes; b++) out[b] = 0;
+    for (size_t i = 1; i < path.size(); i++) {
+        int dx = path[i].first - path[i - 1].first;
+        int dy = path[i].second - path[i - 1].second;
+        int dir = 0;
+        while (dir < 4 && (STEP_DIRS[dir][0] != dx || STEP_DIRS[dir][1] != dy)) dir++;
+        if (dir == 4) return false;
+        out[2 + (i - 1) / 4] |= dir << ((i - 1) % 4 * 2);
+    }
+
+    ref = {(uint16_t)s.numPathBytes, (uint16_t)path.size()};
+    s.numPathBytes += bytes;
+    saved.spans[saved.count] = &path;
+    saved.refs[saved.count++] = ref;
+    return true;
+}
+
+// A restoredPaths entry nothing else holds, or a new one sized for the
+// longest path
+static std::shared_ptr<GridPath> pathStorage(World& w, LoadedPaths& loaded) {
+    while (loaded.nextStorage < w.restoredPaths.size()) {
+        auto& cells = w.restoredPaths[loaded.nextStorage++];
+        if (cells.use_count() == 1) return cells;
+    }
+    auto cells = std::make_shared<GridPath>();
+    cells->reserve(LEVEL_ROWS * LEVEL_COLS);
+    w.restoredPaths.push_back(cells);
+    loaded.nextStorage = w.restoredPaths.size();
+    return cells;
+}
+
+static PathSpan loadPath(World& w, const RollbackState& s, const RollbackState::PathRef& ref,
+                         LoadedPaths& loaded) {
+    if (ref.cells == 0) return PathSpan();
+    for (int i = 0; i < loaded.count; i++)
+        if (loaded.offsets[i] == ref.offset) return loaded.spans[i];
+
+    std::shared_ptr<GridPath> cells = pathStorage(w, loaded);
+    cells->resize(ref.cells);
+    const uint8_t* in = s.pathBytes + ref.offset;
+    (*cells)[0] = {in[0], in[1]};
+    for (int i = 1; i < ref.cells; i++) {
+        int dir = (in[2 + (i - 1) / 4] >> ((i - 1) % 4 * 2)) & 3;
+        (*cells)[i] = {(*cells)[i - 1].first + STEP_DIRS[dir][0], (*cells)[i - 1].second + STEP_DIRS[dir][1]};
+    }
+
+    loaded.offsets[loaded.count] = ref.offset;
+    loaded.spans[loaded.count] = PathSpan(cells);
+    return loaded.spans[loaded.count++];
+}
+
+static RollbackState::Body saveBody(const Sprite& s) {
+    return {s.x, s.y, sharedTextureIndex(s.tex), s.burnEndTime};
+}
+
+static Sprite loadBody(const RollbackState::Body& b) {
+    Sprite s;
+    s.x = b.x;
+    s.y = b.y;
+    s.tex = sharedTexture(b.tex);
+    s.burnEndTime = b.burnEndTime;
+    return s;
+}
+
+bool saveState(const World& w, RollbackState& s) {
+    if (w.enemies.size() > ROLLBACK_MAX_ENEMIES || w.pebbles.size() > ROLLBACK_MAX_PEBBLES ||
+        w.berries.size() > ROLLBACK_MAX_BERRIES || w.items.size() > ROLLBACK_MAX_ITEMS ||
+        w.fires.size() > ROLLBACK_MAX_ITEMS || w.spreadQueue.size() > ROLLBACK_MAX_ITEMS ||
+        w.enemyPaths.size() != w.enemies.size())
+        return false;
+
+    s.currLevel = w.currLevel;
+    s.justTeleported = w.justTeleported;
+    s.spawnPortalID = w.spawnPortalID;
+    s.nowMs = w.nowMs;
+    s.nextBurnMs = w.nextBurnMs;
+    for (int i = 0; i < NUM_ITEM_TYPES; i++)
+        s.inventory[i] = w.inventory.count((ItemId)i);
+    s.player = saveBody(w.player);
+    s.partner = saveBody(w.partner);
+    s.playerMotion = w.playerMotion;
+    s.partnerMotion = w.partnerMotion;
+
+    // Requests still queued will not be asked again after a restore
+    SavedPaths saved;
+    s.numEnemies = (int)w.enemies.size();
+    s.numPathBytes = 0;
+    for (int i = 0; i < s.numEnemies; i++) {
+        const Enemy& e = w.enemies[i];
+        const EnemyPath& p = w.enemyPaths[i];
+        RollbackState::Mover& m = s.enemies[i];
+        m.x = e.x;
+        m.y = e.y;
+        m.speed = e.speed;
+        m.angle = e.angle;
+        m.tex = sharedTextureIndex(e.tex);
+        m.alive = e.alive;
+        if (!savePath(s, p.path, m.path, saved) || !savePath(s, p.result, m.result, saved))
+            return false;
+        m.currentStep = p.currentStep;
+        m.framesUntilRecalc = p.framesUntilRecalc;
+        m.recalcOffset = p.recalcOffset;
+        m.startGridX = p.startGridX;
+        m.startGridY = p.startGridY;
+        m.targetGridX = p.targetGridX;
+        m.targetGridY = p.targetGridY;
+        m.resultFromX = p.resultFromX;
+        m.resultFromY = p.resultFromY;
+        m.moveProgress = p.moveProgress;
+        m.isMoving = p.isMoving;
+        m.hasResult = p.hasResult;
+        m.resultFound = p.resultFound;
+        m.chasing = p.chasing;
+        m.lastSeenX = p.lastSeenX;
+        m.lastSeenY = p.lastSeenY;
+        m.patrolX = p.patrolX;
+        m.patrolY = p.patrolY;
+        m.patrolSeed = p.patrolSeed;
+    }
+
+    s.numPebbles = (int)w.pebbles.size();
+    for (int i = 0; i < s.numPebbles; i++) s.pebbles[i] = w.pebbles[i];
+    s.numBerries = (int)w.berries.size();
+    for (int i = 0; i < s.numBerries; i++) s.berries[i] = w.berries[i];
+    s.numItems = (int)w.items.size();
+    for (int i = 0; i < s.numItems; i++) s.items[i] = saveBody(w.items[i]);
+    s.numFires = (int)w.fires.size();
+    for (int i = 0; i < s.numFires; i++) {
+        s.fires[i][0] = w.fires[i][0];
+        s.fires[i][1] = w.fires[i][1];
+    }
+    s.numSpread = (int)w.spreadQueue.size();
+    for (int i = 0; i < s.numSpread; i++) s.spreadQueue[i] = w.spreadQueue[i];
+    return true;
+}
+
+static int itemCell(float v) {
+    return (int)(v / TILE_SIZE);
+}
+
+void restoreState(World& w, const RollbackState& s) {
+    // Rolled back over a portal or a reload: back into that level's
+    // geometry, with its entities coming from the state below
+    bool rebuildPlanners = s.currLevel != w.currLevel || (int)w.pebbles.size() != s.numPebbles;
+    if (s.currLevel != w.currLevel) {
+        w.currLevel = s.currLevel;
+        w.levelTiles = w.levels[w.currLevel].tiles;
+        w.loadPortals();
+        w.events.levelChanged = true;
+    }
+    w.justTeleported = s.justTeleported;
+    w.spawnPortalID = s.spawnPortalID;
+    w.nowMs = s.nowMs;
+    w.nextBurnMs = s.nextBurnMs;
+    for (int i = 0; i < NUM_ITEM_TYPES; i++)
+        if (w.inventory.count((ItemId)i) != s.inventory[i]) w.inventory.set((ItemId)i, s.inventory[i]);
+    w.player = loadBody(s.player);
+    w.partner = loadBody(s.partner);
+    w.playerMotion = s.playerMotion;
+    w.partnerMotion = s.partnerMotion;
+
+    // Let go of the paths being replaced first, so their storage is free
+    LoadedPaths loaded;
+    w.enemies.resize(s.numEnemies);
+    w.enemyPaths.resize(s.numEnemies);
+    for (EnemyPath& p : w.enemyPaths) {
+        p.path.clear();
+        p.result.clear();
+    }
+    for (int i = 0; i < s.numEnemies; i++) {
+        const RollbackState::Mover& m = s.enemies[i];
+        Enemy& e = w.enemies[i];
+        e.x = m.x;
+        e.y = m.y;
+        e.speed = m.speed;
+        e.angle = m.angle;
+        e.tex = sharedTexture(m.tex);
+        e.alive = m.alive;
+
+        EnemyPath& p = w.enemyPaths[i];
+        p.path = loadPath(w, s, m.path, loaded);
+        p.result = loadPath(w, s, m.result, loaded);
+        p.currentStep = m.currentStep;
+        p.framesUntilRecalc = m.framesUntilRecalc;
+        p.recalcOffset = m.recalcOffset;
+        p.startGridX = m.startGridX;
+        p.startGridY = m.startGridY;
+        p.targetGridX = m.targetGridX;
+        p.targetGridY = m.targetGridY;
+        p.resultFromX = m.resultFromX;
+        p.resultFromY = m.resultFromY;
+        p.moveProgress = m.moveProgress;
+        p.isMoving = m.isMoving;
+        p.hasResult = m.hasResult;
+        p.resultFound = m.resultFound;
+        p.awaitingPath = false;
+        p.chasing = m.chasing;
+        p.lastSeenX = m.lastSeenX;
+        p.lastSeenY = m.lastSeenY;
+        p.patrolX = m.patrolX;
+        p.patrolY = m.patrolY;
+        p.patrolSeed = m.patrolSeed;
+    }
+
+    // Within a level only the cells whose pebble moved are news to the
+    // planners; both the cell it left and the one it is back on
+    int movedCells[2 * ROLLBACK_MAX_PEBBLES][2];
+    int numMoved = 0;
+    if (!rebuildPlanners) {
+        for (int i = 0; i < s.numPebbles; i++) {
+            int fromX, fromY, toX, toY;
+            World::pebbleRestCell(w.pebbles[i], fromX, fromY);
+            World::pebbleRestCell(s.pebbles[i], toX, toY);
+            if (fromX == toX && fromY == toY) continue;
+            movedCells[numMoved][0] = fromX;
+            movedCells[numMoved++][1] = fromY;
+            movedCells[numMoved][0] = toX;
+            movedCells[numMoved++][1] = toY;
+        }
+    }
+    w.pebbles.assign(s.pebbles, s.pebbles + s.numPebbles);
+    w.berries.assign(s.berries, s.berries + s.numBerries);
+
+    bool itemsMoved = (int)w.items.size() != s.numItems;
+    for (int i = 0; i < s.numItems && !itemsMoved; i++)
+        itemsMoved = itemCell(w.items[i].x) != itemCell(s.items[i].x) ||
+                     itemCell(w.items[i].y) != itemCell(s.items[i].y);
+    w.items.resize(s.numItems);
+    for (int i = 0; i < s.numItems; i++) w.items[i] = loadBody(s.items[i]);
+    if (itemsMoved) {
+        w.occupiedPositions.clear();
+        for (const auto& item : w.items) w.occupiedPositions.insert({itemCell(item.x), itemCell(item.y)});
+    }
+    w.fires.clear();
+    for (int i = 0; i < s.numFires; i++) w.fires.push_back({s.fires[i][0], s.fires[i][1]});
+    w.spreadQueue.assign(s.spreadQueue, s.spreadQueue + s.numSpread);
+
+    // Searches in flight were asked by enemies that are no more. Cached
+    // answers, sight and the planners only go stale if the map changed.
+    w.pathQueue.clear();
+    if (rebuildPlanners) {
+        w.mapVersion++;
+        w.resetPlanner();
+    } else if (numMoved > 0) {
+        w.mapVersion++;
+        for (int i = 0; i < numMoved; i++) w.refreshPebbleCell(movedCells[i][0], movedCells[i][1]);
+    }
+    w.rebuildEntityHash();
+}
+
+// ----------------------------------------------------------------------------
+// Ring
+// ----------------------------------------------------------------------------
+
+void RollbackRing::resize(int size) {
+    slots.resize(size);
+    slotTicks.assign(size, -1);
+}
+
+bool RollbackRing::save(int tick, const World& w) {
+    if (slots.empty()) return false;
+    int slot = tick % size();
+    slotTicks[slot] = -1;
+    if (!saveState(w, slots[slot])) return false;
+    slotTicks[slot] = tick;
+    return true;
+}
+
+bool RollbackRing::has(int tick) const {
+    return !slots.empty() && tick >= 0 && slotTicks[tick % size()] == tick;
+}
+
+bool RollbackRing::restore(int tick, World& w) const {
+    if (!has(tick)) return false;
+    restoreState(w, slots[tick % size()]);
+    return true;
+}
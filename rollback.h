@@ -0,0 +1,120 @@
+// ============================================================================
+// rollback.h
+// FIXED-SIZE WORLD STATE FOR ROLLBACK AND LOOKAHEAD
+// ============================================================================
+//
+// Everything a tick changes, in one flat struct with no pointers: the
+// players and their recent motion, enemies with their path following
+// state, pebbles, berries, items with their burn timers, fires, inventory
+// and the clocks. Copying one (a ring slot, a lookahead scratch copy) is
+// a single memcpy of sizeof(RollbackState) bytes.
+//
+// The level geometry, portals and planners are not stored. Restoring
+// within a level only tells the planners, path cache and next-hop tables
+// about the cells whose pebble moved, and decodes paths into storage the
+// world keeps for it (World::restoredPaths), so it costs about a
+// microsecond on the built-in levels and does not allocate once warm.
+// Restoring across a level change rebuilds them from the level table.
+// Searches in flight are not stored either: restoring into the world is
+// exact when the state was saved with an empty path queue, which is
+// always the case with no step limit in pathBudget and no PathWorker.
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include "world.h"
+
+// Capacities. The level table limits enemies, pebbles and berries, and a
+// level never holds more items (or fires) than the bags the player starts
+// it with. Paths take two bytes for their first cell and two bits per
+// step after it; every enemy can hold two (the one it follows and an
+// answer waiting at the next cell boundary).
+const int ROLLBACK_MAX_ENEMIES = MAX_LEVEL_ENEMIES;
+const int ROLLBACK_MAX_PEBBLES = MAX_LEVEL_PEBBLES;
+const int ROLLBACK_MAX_BERRIES = MAX_LEVEL_BERRIES;
+const int ROLLBACK_MAX_ITEMS = 16;
+const int ROLLBACK_MAX_PATH_BYTES = 16384;
+
+static_assert(ROLLBACK_MAX_ITEMS >= ITEM_INFO[ITEM_BAG].maxStack, "a level's items must fit");
+static_assert(ROLLBACK_MAX_PATH_BYTES >= 2 * ROLLBACK_MAX_ENEMIES * (2 + (LEVEL_ROWS * LEVEL_COLS + 3) / 4),
+              "the longest paths of every enemy must fit");
+
+struct RollbackState {
+    struct Body {
+        float x, y;
+        uint8_t tex;            // sharedTextureIndex
+        long long burnEndTime;
+    };
+
+    // Where a path's bytes are in `pathBytes`; cells == 0 for no path
+    struct PathRef {
+        uint16_t offset;
+        uint16_t cells;
+    };
+
+    struct Mover {
+        float x, y, speed, angle;
+        uint8_t tex;
+        bool alive;
+
+        PathRef path, result;
+        int currentStep, framesUntilRecalc, recalcOffset;
+        int startGridX, startGridY, targetGridX, targetGridY;
+        int resultFromX, resultFromY;
+        float moveProgress;
+        bool isMoving, hasResult, resultFound;
+
+        bool chasing;
+        int lastSeenX, lastSeenY, patrolX, patrolY;
+        uint32_t patrolSeed;
+    };
+
+    int currLevel;
+    bool justTeleported;
+    int spawnPortalID;
+    long long nowMs, nextBurnMs;
+    int inventory[NUM_ITEM_TYPES];
+    Body player, partner;
+    PlayerMotion playerMotion, partnerMotion;
+
+    int numEnemies, numPebbles, numBerries, numItems, numFires, numSpread, numPathBytes;
+    Mover enemies[ROLLBACK_MAX_ENEMIES];
+    Pebble pebbles[ROLLBACK_MAX_PEBBLES];
+    Berry berries[ROLLBACK_MAX_BERRIES];
+    Body items[ROLLBACK_MAX_ITEMS];
+    int fires[ROLLBACK_MAX_ITEMS][2];
+    BurnCheckEvent spreadQueue[ROLLBACK_MAX_ITEMS];
+    uint8_t pathBytes[ROLLBACK_MAX_PATH_BYTES];
+};
+
+static_assert(std::is_trivially_copyable<RollbackState>::value, "RollbackState must copy as plain bytes");
+
+// Stores `w` in `out`; false, with `out` unusable, if the world holds more
+// than the capacities above (stress levels) or a path that does not step
+// one cell at a time
+bool saveState(const World& w, RollbackState& out);
+
+// Puts `w` back to the saved state. The world must be the one it was saved
+// from, or one playing the same levels.
+void restoreState(World& w, const RollbackState& state);
+
+// The last `size` saved ticks, by tick number
+class RollbackRing {
+public:
+    explicit RollbackRing(int size = 0) { resize(size); }
+    void resize(int size);
+    int size() const { return (int)slots.size(); }
+
+    // Saves `w` as it is before tick `tick`; false if it does not fit
+    bool save(int tick, const World& w);
+
+    // False if `tick` was never saved or has since been overwritten
+    bool has(int tick) const;
+    bool restore(int tick, World& w) const;
+
+private:
+    std::vector<RollbackState> slots;
+    std::vector<int> slotTicks;         // tick each slot holds, -1 for none
+};
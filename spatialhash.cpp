@@ -0,0 +1,20 @@
+// ============================================================================
+// spatialhash.cpp
+// SPARSE SPATIAL HASH FOR MOVING ENTITIES
+// ============================================================================
+
+#include "spatialhash.h"
+
+void SpatialHash::clear() {
+    for (uint64_t k : occupied) buckets[k].clear();
+    occupied.clear();
+    count = 0;
+}
+
+void SpatialHash::insert(EntityKind kind, int index, float x, float y) {
+    uint64_t k = key(cellOf(x), cellOf(y));
+    std::vector<EntityRef>& bucket = buckets[k];
+    if (bucket.empty()) occupied.push_back(k);
+    bucket.push_back({kind, index, x, y});
+    count++;
+}
@@ -0,0 +1,67 @@
+// ============================================================================
+// spatialhash.h
+// SPARSE SPATIAL HASH FOR MOVING ENTITIES
+// ============================================================================
+
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cmath>
+
+enum EntityKind : uint8_t {
+    ENTITY_PLAYER,
+    ENTITY_ENEMY,
+    ENTITY_PEBBLE,      // sliding pebbles only; resting ones sit on their cell
+};
+
+// One entity in the hash: what it is, its index in the World vector it
+// lives in, and the position it was inserted at
+struct EntityRef {
+    EntityKind kind;
+    int index;
+    float x, y;
+};
+
+// Buckets of entities keyed by the cell their position falls in. Only
+// occupied cells have a bucket, so it does not care how big the map is,
+// and a neighbourhood query looks at a handful of buckets instead of
+// every entity. Rebuilt each tick from scratch: clear() keeps the bucket
+// storage, so steady-state rebuilds do not allocate.
+class SpatialHash {
+public:
+    explicit SpatialHash(float cellSize) : cellSize(cellSize) {}
+
+    void clear();
+    void insert(EntityKind kind, int index, float x, float y);
+    size_t size() const { return count; }
+
+    // Calls fn(const EntityRef&) for every entity in the cells overlapping
+    // the square of half-size `radius` around (x, y). That is a superset
+    // of the entities within `radius`; callers do the exact test.
+    template <typename Fn>
+    void forEachNear(float x, float y, float radius, Fn&& fn) const {
+        int x0 = cellOf(x - radius), x1 = cellOf(x + radius);
+        int y0 = cellOf(y - radius), y1 = cellOf(y + radius);
+        for (int cy = y0; cy <= y1; cy++) {
+            for (int cx = x0; cx <= x1; cx++) {
+                auto it = buckets.find(key(cx, cy));
+                if (it == buckets.end()) continue;
+                for (const EntityRef& e : it->second) fn(e);
+            }
+        }
+    }
+
+private:
+    int cellOf(float v) const { return (int)std::floor(v / cellSize); }
+
+    static uint64_t key(int cx, int cy) {
+        return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+    }
+
+    float cellSize;
+    size_t count = 0;
+    std::unordered_map<uint64_t, std::vector<EntityRef>> buckets;
+    std::vector<uint64_t> occupied;     // keys of non-empty buckets
+};
@@ -0,0 +1,242 @@
+// ============================================================================
+// sprites.cpp
+// INSTANCED SPRITE RENDERING (GL 3.3)
+// ============================================================================
+
+#include "sprites.h"
+#include <GL/glext.h>
+#include <cstdio>
+#include <cstddef>
+
+// GL 3.3 entry points, looked up at runtime so the game still starts on
+// drivers that only offer the fixed-function path
+static struct {
+    PFNGLCREATESHADERPROC createShader;
+    PFNGLSHADERSOURCEPROC shaderSource;
+    PFNGLCOMPILESHADERPROC compileShader;
+    PFNGLGETSHADERIVPROC getShaderiv;
+    PFNGLGETSHADERINFOLOGPROC getShaderInfoLog;
+    PFNGLDELETESHADERPROC deleteShader;
+    PFNGLCREATEPROGRAMPROC createProgram;
+    PFNGLATTACHSHADERPROC attachShader;
+    PFNGLLINKPROGRAMPROC linkProgram;
+    PFNGLGETPROGRAMIVPROC getProgramiv;
+    PFNGLDELETEPROGRAMPROC deleteProgram;
+    PFNGLUSEPROGRAMPROC useProgram;
+    PFNGLGETUNIFORMLOCATIONPROC getUniformLocation;
+    PFNGLUNIFORM1IPROC uniform1i;
+    PFNGLUNIFORM1FPROC uniform1f;
+    PFNGLUNIFORM2FPROC uniform2f;
+    PFNGLGENVERTEXARRAYSPROC genVertexArrays;
+    PFNGLBINDVERTEXARRAYPROC bindVertexArray;
+    PFNGLGENBUFFERSPROC genBuffers;
+    PFNGLBINDBUFFERPROC bindBuffer;
+    PFNGLBUFFERDATAPROC bufferData;
+    PFNGLBUFFERSUBDATAPROC bufferSubData;
+    PFNGLVERTEXATTRIBPOINTERPROC vertexAttribPointer;
+    PFNGLENABLEVERTEXATTRIBARRAYPROC enableVertexAttribArray;
+    PFNGLVERTEXATTRIBDIVISORPROC vertexAttribDivisor;
+    PFNGLDRAWARRAYSINSTANCEDPROC drawArraysInstanced;
+    PFNGLTEXIMAGE3DPROC texImage3D;
+    PFNGLTEXSUBIMAGE3DPROC texSubImage3D;
+    PFNGLACTIVETEXTUREPROC activeTexture;
+} gl;
+
+template <typename Fn>
+static bool load(Fn& fn, const char* name) {
+    fn = (Fn)getGLProcAddress(name);
+    return fn != nullptr;
+}
+
+static bool loadGL33() {
+    int major = 0, minor = 0;
+    const char* version = (const char*)glGetString(GL_VERSION);
+    if (!version || sscanf(version, "%d.%d", &major, &minor) != 2) return false;
+    if (major < 3 || (major == 3 && minor < 3)) return false;
+
+    return load(gl.createShader, "glCreateShader") &&
+           load(gl.shaderSource, "glShaderSource") &&
+           load(gl.compileShader, "glCompileShader") &&
+           load(gl.getShaderiv, "glGetShaderiv") &&
+           load(gl.getShaderInfoLog, "glGetShaderInfoLog") &&
+           load(gl.deleteShader, "glDeleteShader") &&
+           load(gl.createProgram, "glCreateProgram") &&
+           load(gl.attachShader, "glAttachShader") &&
+           load(gl.linkProgram, "glLinkProgram") &&
+           load(gl.getProgramiv, "glGetProgramiv") &&
+           load(gl.deleteProgram, "glDeleteProgram") &&
+           load(gl.useProgram, "glUseProgram") &&
+           load(gl.getUniformLocation, "glGetUniformLocation") &&
+           load(gl.uniform1i, "glUniform1i") &&
+           load(gl.uniform1f, "glUniform1f") &&
+           load(gl.uniform2f, "glUniform2f") &&
+           load(gl.genVertexArrays, "glGenVertexArrays") &&
+           load(gl.bindVertexArray, "glBindVertexArray") &&
+           load(gl.genBuffers, "glGenBuffers") &&
+           load(gl.bindBuffer, "glBindBuffer") &&
+           load(gl.bufferData, "glBufferData") &&
+           load(gl.bufferSubData, "glBufferSubData") &&
+           load(gl.vertexAttribPointer, "glVertexAttribPointer") &&
+           load(gl.enableVertexAttribArray, "glEnableVertexAttribArray") &&
+           load(gl.vertexAttribDivisor, "glVertexAttribDivisor") &&
+           load(gl.drawArraysInstanced, "glDrawArraysInstanced") &&
+           load(gl.texImage3D, "glTexImage3D") &&
+           load(gl.texSubImage3D, "glTexSubImage3D") &&
+           load(gl.activeTexture, "glActiveTexture");
+}
+
+// The quad is a 4-vertex strip generated from gl_VertexID; only the
+// per-instance attributes come from a buffer. Rotation matches glRotatef
+// about the sprite centre with y pointing down the window.
+static const char* VERTEX_SHADER = R"(
+#version 330
+layout(location = 0) in vec2 pos;
+layout(location = 1) in float angle;
+layout(location = 2) in float layer;
+uniform vec2 view;
+uniform float size;
+out vec3 uv;
+void main() {
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 local = (corner - 0.5) * size;
+    float c = cos(radians(angle));
+    float s = sin(radians(angle));
+    vec2 p = pos + 0.5 * size + vec2(local.x * c - local.y * s, local.x * s + local.y * c);
+    gl_Position = vec4(p.x / view.x * 2.0 - 1.0, 1.0 - p.y / view.y * 2.0, 0.0, 1.0);
+    uv = vec3(corner, layer);
+}
+)";
+
+static const char* FRAGMENT_SHADER = R"(
+#version 330
+in vec3 uv;
+uniform sampler2DArray sprites;
+out vec4 color;
+void main() {
+    color = texture(sprites, uv);
+}
+)";
+
+static GLuint compile(GLenum type, const char* source) {
+    GLuint shader = gl.createShader(type);
+    gl.shaderSource(shader, 1, &source, nullptr);
+    gl.compileShader(shader);
+
+    GLint ok = 0;
+    gl.getShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[512];
+        gl.getShaderInfoLog(shader, sizeof(log), nullptr, log);
+        printf("Sprite shader failed: %s\n", log);
+        gl.deleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+bool InstancedSprites::init(const Texture* const* textures, int count, int size) {
+    if (program || count <= 0 || !loadGL33()) return false;
+
+    for (int i = 0; i < count; i++)
+        if (textures[i]->id == 0 || textures[i]->w != size || textures[i]->h != size)
+            return false;
+
+    GLuint vs = compile(GL_VERTEX_SHADER, VERTEX_SHADER);
+    GLuint fs = compile(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+    if (!vs || !fs) {
+        if (vs) gl.deleteShader(vs);
+        if (fs) gl.deleteShader(fs);
+        return false;
+    }
+
+    GLuint prog = gl.createProgram();
+    gl.attachShader(prog, vs);
+    gl.attachShader(prog, fs);
+    gl.linkProgram(prog);
+    gl.deleteShader(vs);
+    gl.deleteShader(fs);
+
+    GLint linked = 0;
+    gl.getProgramiv(prog, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        gl.deleteProgram(prog);
+        return false;
+    }
+
+    // Copy each sprite out of its 2D texture into one array layer
+    glGenTextures(1, &textureArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gl.texImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, size, size, count, 0,
+                  GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    std::vector<unsigned char> pixels(size * size * 4);
+    for (int i = 0; i < count; i++) {
+        glBindTexture(GL_TEXTURE_2D, textures[i]->id);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        gl.texSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, size, size, 1,
+                         GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        layerTex.push_back(textures[i]->id);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    gl.genVertexArrays(1, &vao);
+    gl.genBuffers(1, &instanceBuffer);
+    gl.bindVertexArray(vao);
+    gl.bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    const GLsizei stride = sizeof(Instance);
+    gl.vertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Instance, x));
+    gl.vertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Instance, angle));
+    gl.vertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Instance, layer));
+    for (int a = 0; a < 3; a++) {
+        gl.enableVertexAttribArray(a);
+        gl.vertexAttribDivisor(a, 1);
+    }
+    gl.bindVertexArray(0);
+    gl.bindBuffer(GL_ARRAY_BUFFER, 0);
+
+    viewLoc = gl.getUniformLocation(prog, "view");
+    sizeLoc = gl.getUniformLocation(prog, "size");
+    samplerLoc = gl.getUniformLocation(prog, "sprites");
+    program = prog;
+    return true;
+}
+
+int InstancedSprites::layerOf(GLuint tex) const {
+    for (size_t i = 0; i < layerTex.size(); i++)
+        if (layerTex[i] == tex) return (int)i;
+    return -1;
+}
+
+void InstancedSprites::draw(const Instance* instances, int count, float width) {
+    if (!program || count <= 0) return;
+
+    // Same mapping as the glOrtho(0, w, h, 0) projection in reshape()
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    gl.bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    if (count > bufferCapacity) {
+        bufferCapacity = count * 2;
+        gl.bufferData(GL_ARRAY_BUFFER, bufferCapacity * sizeof(Instance), nullptr, GL_STREAM_DRAW);
+    }
+    gl.bufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(Instance), instances);
+    gl.bindBuffer(GL_ARRAY_BUFFER, 0);
+
+    gl.useProgram(program);
+    gl.uniform2f(viewLoc, (float)viewport[2], (float)viewport[3]);
+    gl.uniform1f(sizeLoc, width);
+    gl.uniform1i(samplerLoc, 0);
+
+    gl.activeTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+    gl.bindVertexArray(vao);
+    gl.drawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    gl.bindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    gl.useProgram(0);
+}
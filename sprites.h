@@ -0,0 +1,52 @@
+// ============================================================================
+// sprites.h
+// INSTANCED SPRITE RENDERING (GL 3.3)
+// ============================================================================
+
+#pragma once
+
+#include <vector>
+#include "utils.h"
+
+// Draws a batch of rotated, same-sized sprites in one instanced call.
+// Each instance is a position, an angle and a layer of one texture array
+// built from the sprites' textures, so a whole layer of ants costs one
+// draw instead of a push/translate/rotate/pop per ant.
+//
+// Needs GL 3.3 entry points and GLSL 3.30 in the current (compatibility)
+// context. If init() fails, ready() stays false and callers keep using
+// drawQuadRotated().
+class InstancedSprites {
+public:
+    struct Instance {
+        float x, y;         // top-left, like drawQuadRotated
+        float angle;        // degrees
+        float layer;
+    };
+
+    InstancedSprites() = default;
+    InstancedSprites(const InstancedSprites&) = delete;
+    InstancedSprites& operator=(const InstancedSprites&) = delete;
+
+    // Compiles the shader and copies `textures` (all `size` x `size`) into
+    // an array texture, in order. Call with the GL context current.
+    bool init(const Texture* const* textures, int count, int size);
+    bool ready() const { return program != 0; }
+
+    // Texture array layer holding `tex`, or -1 if it was not given to init()
+    int layerOf(GLuint tex) const;
+
+    // Draws `count` instances as `width`-sized squares, in the same window
+    // coordinates as the glOrtho projection. Restores the fixed-function
+    // state (program, bindings) before returning.
+    void draw(const Instance* instances, int count, float width);
+
+private:
+    GLuint program = 0;
+    GLuint vao = 0;
+    GLuint instanceBuffer = 0;
+    GLuint textureArray = 0;
+    int bufferCapacity = 0;
+    int viewLoc = -1, sizeLoc = -1, samplerLoc = -1;
+    std::vector<GLuint> layerTex;
+};
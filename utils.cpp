@@ -1,15 +1,64 @@
 #include <GL/freeglut.h>
 #include <GL/glext.h>   // <-- REQUIRED for GL_CLAMP_TO_EDGE
 #include "utils.h"
+#include "clock.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
-#include <chrono>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif !defined(__APPLE__)
+#include <GL/glx.h>
+#endif
 
 
 long long getCurrentTimeMillis() {
-    return std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count();
+    return monotonicNanos() / NANOS_PER_MILLI;
+}
+
+long long getCurrentTimeMicros() {
+    return monotonicNanos() / NANOS_PER_MICRO;
+}
+
+void* getGLProcAddress(const char* name) {
+#if defined(_WIN32)
+    return (void*)wglGetProcAddress(name);
+#elif defined(__APPLE__)
+    return (void*)glutGetProcAddress(name);
+#else
+    return (void*)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+}
+
+bool setSwapInterval(int interval) {
+#if defined(_WIN32)
+    typedef BOOL (WINAPI *SwapIntervalEXT)(int);
+    SwapIntervalEXT swapInterval = (SwapIntervalEXT)wglGetProcAddress("wglSwapIntervalEXT");
+    return swapInterval && swapInterval(interval);
+#elif defined(__APPLE__)
+    (void)interval;
+    return false;
+#else
+    typedef int (*SwapIntervalMESA)(unsigned int);
+    typedef int (*SwapIntervalSGI)(int);
+    typedef void (*SwapIntervalEXT)(Display*, GLXDrawable, int);
+
+    SwapIntervalEXT ext = (SwapIntervalEXT)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalEXT");
+    Display* dpy = glXGetCurrentDisplay();
+    GLXDrawable drawable = glXGetCurrentDrawable();
+    if (ext && dpy && drawable) {
+        ext(dpy, drawable, interval);
+        return true;
+    }
+
+    SwapIntervalMESA mesa = (SwapIntervalMESA)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalMESA");
+    if (mesa) return mesa(interval) == 0;
+
+    // SGI's version cannot turn sync off
+    SwapIntervalSGI sgi = (SwapIntervalSGI)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalSGI");
+    if (sgi && interval > 0) return sgi(interval) == 0;
+    return false;
+#endif
 }
 
 Texture loadTexture(const char* path) {
@@ -7,8 +7,17 @@ struct Texture {
     int w, h;
 };
 
-// Time
+// Time, from the steady clock (see clock.h); only differences mean anything
 long long getCurrentTimeMillis();
+long long getCurrentTimeMicros();
+
+// Sync buffer swaps to the display refresh (1) or not (0), on the current
+// GL context. Returns false if the driver offers no swap control.
+bool setSwapInterval(int interval);
+
+// GL entry point beyond 1.1, or nullptr. Works without glutInit(), so the
+// offscreen paths can use it too.
+void* getGLProcAddress(const char* name);
 
 // Texture loading
 Texture loadTexture(const char* path);
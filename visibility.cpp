@@ -0,0 +1,90 @@
+// ============================================================================
+// visibility.cpp
+// SHADOW-CASTING FIELD OF VIEW, CACHED PER CELL
+// ============================================================================
+
+#include "visibility.h"
+#include <cstring>
+#include <algorithm>
+
+// Maps an octant's (column, row) onto grid offsets: x = col*xx + row*xy,
+// y = col*yx + row*yy
+static const int OCTANTS[8][4] = {
+    {1, 0, 0, 1}, {0, 1, 1, 0}, {0, -1, 1, 0}, {-1, 0, 0, 1},
+    {-1, 0, 0, -1}, {0, -1, -1, 0}, {0, 1, -1, 0}, {1, 0, 0, -1},
+};
+
+void VisibilityCache::setOccluders(const uint8_t* cells, int w, int h, uint32_t version) {
+    if (current(version) && w == width && h == height) return;
+
+    if (w != width || h != height) {
+        width = w;
+        height = h;
+        fields.assign((size_t)w * h * w * h, 0);
+        fieldGeneration.assign((size_t)w * h, 0);
+    }
+    opaque.assign(cells, cells + w * h);
+    occluderVersion = version;
+    generation++;
+    ready = true;
+}
+
+const uint8_t* VisibilityCache::from(int x, int y) {
+    if (!ready || x < 0 || x >= width || y < 0 || y >= height) return nullptr;
+
+    int origin = y * width + x;
+    uint8_t* field = fields.data() + (size_t)origin * width * height;
+    if (fieldGeneration[origin] == generation) return field;
+
+    memset(field, 0, width * height);
+    field[origin] = 1;
+    for (const auto& o : OCTANTS)
+        cast(x, y, 1, 1.0f, 0.0f, o[0], o[1], o[2], o[3], field);
+
+    fieldGeneration[origin] = generation;
+    buildCount++;
+    return field;
+}
+
+// Lights row `row` onwards of one octant between slopes `start` and `end`
+// (1 along the diagonal, 0 straight out). An opaque run splits the range:
+// the part left of it carries on in a recursive call, and the scan here
+// resumes right of it.
+void VisibilityCache::cast(int originX, int originY, int row, float start, float end,
+                           int xx, int xy, int yx, int yy, uint8_t* out) const
+{
+    if (start < end) return;
+    int radius = std::max(width, height);
+
+    float nextStart = start;
+    for (int j = row; j <= radius; j++) {
+        bool blocked = false;
+        for (int dx = -j; dx <= 0; dx++) {
+            int dy = -j;
+            float leftSlope = (dx - 0.5f) / (dy + 0.5f);
+            float rightSlope = (dx + 0.5f) / (dy - 0.5f);
+            if (start < rightSlope) continue;
+            if (end > leftSlope) break;
+
+            int x = originX + dx * xx + dy * xy;
+            int y = originY + dx * yx + dy * yy;
+            bool inside = x >= 0 && x < width && y >= 0 && y < height;
+            if (inside) out[y * width + x] = 1;
+            bool isOpaque = !inside || opaque[y * width + x];
+
+            if (blocked) {
+                if (isOpaque) {
+                    nextStart = rightSlope;
+                    continue;
+                }
+                blocked = false;
+                start = nextStart;
+            } else if (isOpaque && j < radius) {
+                blocked = true;
+                cast(originX, originY, j + 1, start, leftSlope, xx, xy, yx, yy, out);
+                nextStart = rightSlope;
+            }
+        }
+        if (blocked) break;
+    }
+}
@@ -0,0 +1,48 @@
+// ============================================================================
+// visibility.h
+// SHADOW-CASTING FIELD OF VIEW, CACHED PER CELL
+// ============================================================================
+//
+// Which cells can be seen from a cell, with walls and resting pebbles
+// blocking sight. A field is computed by recursive shadow casting: each of
+// the eight octants is scanned row by row outwards from the origin, and
+// every opaque cell met narrows the slopes that rows further out can still
+// show. Opaque cells themselves are seen, so a room's walls are lit.
+//
+// The occluders only change with the map, and the player only moves a
+// cell every few ticks, so fields are kept per origin cell until the
+// occluders change; asking again from the same cell is one array read.
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+class VisibilityCache {
+public:
+    // What blocks sight: width*height bytes, nonzero for an opaque cell,
+    // as of map version `version`. Fields built for other occluders are
+    // dropped; the same version again costs nothing.
+    void setOccluders(const uint8_t* opaque, int width, int height, uint32_t version);
+    bool current(uint32_t version) const { return ready && occluderVersion == version; }
+
+    // Cells visible from (x, y), width*height bytes, nonzero for visible;
+    // nullptr outside the grid. Built on first use, and valid until the
+    // occluders change.
+    const uint8_t* from(int x, int y);
+
+    long long builds() const { return buildCount; }
+
+private:
+    void cast(int originX, int originY, int row, float start, float end,
+              int xx, int xy, int yx, int yy, uint8_t* out) const;
+
+    int width = 0, height = 0;
+    bool ready = false;
+    uint32_t occluderVersion = 0;
+    uint32_t generation = 0;            // bumped whenever the occluders change
+    std::vector<uint8_t> opaque;
+    std::vector<uint8_t> fields;        // width*height bytes per origin cell
+    std::vector<uint32_t> fieldGeneration;
+    long long buildCount = 0;
+};
@@ -0,0 +1,1464 @@
+// ============================================================================
+// world.cpp
+// GAME SIMULATION - movement, pebbles, enemy AI, fire
+// ============================================================================
+
+#include "world.h"
+#include "jobs.h"
+#include "levelgen.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <memory>
+
+using std::string;
+using std::vector;
+
+// Ticks an enemy follows a path before searching again
+static const int RECALC_FRAMES = 30;
+
+// Fraction of a cell an enemy walks per tick
+static const float ENEMY_MOVE_SPEED = 0.05f;
+static const int ENEMY_TICKS_PER_CELL = (int)(1 / ENEMY_MOVE_SPEED);
+
+// CHASE_INTERCEPT looks this many ticks further ahead per horizon (a
+// player crosses a cell in 16), and replans early once the best cell is
+// this many cells from where the current path ends
+static const int INTERCEPT_STEP_TICKS = 24;
+static const int INTERCEPT_DRIFT = 3;
+
+// Under lineOfSight, an enemy with nobody in view walks to cells at least
+// PATROL_MIN_CELLS and at most PATROL_RANGE cells (each way) from it
+static const int PATROL_MIN_CELLS = 3;
+static const int PATROL_RANGE = 6;
+
+Texture playerTex, itemTex, wallTex, floorTex, flameTex, holeTex, berryTex, antTex, deadantTex, pebbleTex;
+
+static Texture* const SHARED_TEXTURES[] = {&playerTex, &itemTex, &wallTex, &floorTex, &flameTex,
+                                           &holeTex, &berryTex, &antTex, &deadantTex, &pebbleTex};
+static const int NUM_SHARED_TEXTURES = sizeof(SHARED_TEXTURES) / sizeof(SHARED_TEXTURES[0]);
+
+uint8_t sharedTextureIndex(const Texture* t) {
+    for (int i = 0; i < NUM_SHARED_TEXTURES; i++)
+        if (t == SHARED_TEXTURES[i]) return (uint8_t)i;
+    return NO_SHARED_TEXTURE;
+}
+
+Texture* sharedTexture(uint8_t index) {
+    return index < NUM_SHARED_TEXTURES ? SHARED_TEXTURES[index] : nullptr;
+}
+
+World::World() {
+    player.x = 64;
+    player.y = 64;
+    player.tex = &playerTex;
+    partner = player;
+    inventory.set(ITEM_BAG, ITEM_INFO[ITEM_BAG].maxStack);
+}
+
+void World::log(const char* fmt, ...) const {
+    if (!verbose) return;
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+}
+
+// ============================================================================
+// COLLISION
+// ============================================================================
+
+bool World::checkPebbleCollision(float x, float y, Pebble* ignorePebble) {
+    int gx = x / TILE_SIZE;
+    int gy = y / TILE_SIZE;
+
+    for (auto& pebble : pebbles) {
+        if (&pebble == ignorePebble) continue;
+
+        int px = pebble.x / TILE_SIZE;
+        int py = pebble.y / TILE_SIZE;
+
+        if (gx == px && gy == py) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool World::checkCollision(float newX, float newY) {
+    int gx = newX / TILE_SIZE;
+    int gy = newY / TILE_SIZE;
+
+    if (gx < 0 || gx >= COLS || gy < 0 || gy >= ROWS)
+        return true;
+
+    if (levelTiles[gy][gx] == 1)
+        return true;
+
+    // Check pebble collision
+    for (const auto& pebble : pebbles) {
+        int px = pebble.x / TILE_SIZE;
+        int py = pebble.y / TILE_SIZE;
+        if (gx == px && gy == py) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// ============================================================================
+// PORTAL SYSTEM
+// ============================================================================
+
+void World::loadPortals() {
+    portals.clear();
+    const auto& defs = levels[currLevel].portals;
+    for (const auto& def : defs) {
+        Portal P;
+        P.gridX = def.x;
+        P.gridY = def.y;
+        P.portalID = def.portalID;
+        P.targetLevel = def.targetLevel;
+        P.targetPortalID = def.targetPortalID;
+        portals.push_back(P);
+        log("Loaded Portal ID %d at [%d,%d] -> Level %d, PortalID %d\n",
+            P.portalID, P.gridX, P.gridY, P.targetLevel, P.targetPortalID);
+    }
+}
+
+void World::addBerry(const BerryDef& def) {
+    Berry B;
+    B.gridX = def.x;
+    B.gridY = def.y;
+    B.berryID = def.berryID;
+    berries.push_back(B);
+    log("Loaded Berry ID %d at [%d,%d]\n", B.berryID, B.gridX, B.gridY);
+}
+
+void World::loadBerries() {
+    berries.clear();
+    if (generated)
+        for (const auto& def : generated->berries) addBerry(def);
+    else
+        for (const auto& def : levels[currLevel].berries) addBerry(def);
+}
+
+void World::addEnemy(const EnemyDef& def) {
+    Enemy E;
+    E.x = def.x * TILE_SIZE;
+    E.y = def.y * TILE_SIZE;
+    E.speed = 1.0f;
+    E.angle = 0.0f;
+    E.tex = &antTex;
+    E.alive = true;
+    enemies.push_back(E);
+    log("Loaded Enemy ID %d at [%d,%d]\n", def.enemyID, def.x, def.y);
+}
+
+void World::loadEnemies() {
+    enemies.clear();
+    enemyPaths.clear();
+    pathQueue.clear();
+    if (generated)
+        for (const auto& def : generated->enemies) addEnemy(def);
+    else
+        for (const auto& def : levels[currLevel].enemies) addEnemy(def);
+
+    // Spread the first replans over one period, or every enemy searches
+    // on the same tick for the rest of the level
+    enemyPaths.assign(enemies.size(), EnemyPath());
+    for (size_t i = 0; i < enemies.size(); i++) {
+        enemyPaths[i].recalcOffset = (int)(i * RECALC_FRAMES / enemies.size());
+        enemyPaths[i].patrolSeed = (uint32_t)(i + 1) * 2654435761u;
+    }
+}
+
+void World::addPebble(const PebbleDef& def) {
+    Pebble P;
+    P.x = def.x * TILE_SIZE;
+    P.y = def.y * TILE_SIZE;
+    P.isBeingPushed = false;
+    P.pushStartTime = 0;
+    P.pushDirX = 0.0f;
+    P.pushDirY = 0.0f;
+    P.isSliding = false;
+    P.targetGridX = 0;
+    P.targetGridY = 0;
+    P.slideProgress = 0.0f;
+    pebbles.push_back(P);
+    log("Loaded Pebble ID %d at [%d,%d]\n", def.pebbleID, def.x, def.y);
+}
+
+void World::loadPebbles() {
+    pebbles.clear();
+    if (generated)
+        for (const auto& def : generated->pebbles) addPebble(def);
+    else
+        for (const auto& def : levels[currLevel].pebbles) addPebble(def);
+}
+
+Portal* World::findPortalByID(int portalID) {
+    for (auto& p : portals)
+        if (p.portalID == portalID)
+            return &p;
+    return nullptr;
+}
+
+// ============================================================================
+// LEVEL LOADING
+// ============================================================================
+
+void World::loadLevel(int levelIndex, int fromPortalID) {
+    if (levelIndex < 0 || levelIndex >= NUM_LEVELS) {
+        log("Invalid level: %d\n", levelIndex);
+        return;
+    }
+
+    currLevel = levelIndex;
+    levelTiles = levels[currLevel].tiles;
+    mapVersion++;
+
+    items.clear();
+    occupiedPositions.clear();
+    spreadQueue.clear();
+    inventory.set(ITEM_BAG, ITEM_INFO[ITEM_BAG].maxStack);
+
+    loadPortals();
+    loadBerries();
+    loadEnemies();
+    loadPebbles();
+    resetPlanner();
+
+    if (fromPortalID >= 0) {
+        Portal* spawnP = findPortalByID(fromPortalID);
+        if (spawnP) {
+            player.x = spawnP->gridX * TILE_SIZE;
+            player.y = spawnP->gridY * TILE_SIZE;
+            spawnPortalID = fromPortalID;
+            justTeleported = true;
+            log("Spawned at portal ID %d in level %d\n", fromPortalID, currLevel);
+        } else {
+            player.x = 64;
+            player.y = 64;
+            spawnPortalID = -1;
+            justTeleported = false;
+        }
+    } else {
+        player.x = 64;
+        player.y = 64;
+        spawnPortalID = -1;
+        justTeleported = false;
+    }
+
+    partner.x = player.x;
+    partner.y = player.y;
+    playerMotion = partnerMotion = PlayerMotion();
+
+    events.levelChanged = true;
+    log("\n=== Loaded Level %d ===\n", currLevel);
+}
+
+void World::loadGenerated(const GeneratedLevel& level) {
+    if (level.width != COLS || level.height != ROWS) {
+        log("Generated level is %dx%d, the world is %dx%d\n", level.width, level.height, COLS, ROWS);
+        return;
+    }
+
+    // Every slot holds the generated level, so anything indexing the
+    // NUM_LEVELS table (loadLevel, replay level hashes) stays in bounds
+    std::shared_ptr<LevelData[]> table(new LevelData[NUM_LEVELS]);
+    for (int i = 0; i < NUM_LEVELS; i++) {
+        for (int y = 0; y < ROWS; y++)
+            for (int x = 0; x < COLS; x++)
+                table[i].tiles[y][x] = level.tiles[y * COLS + x];
+        table[i].pathMode = level.pathMode;
+    }
+
+    generated = std::make_shared<const GeneratedLevel>(level);
+    generatedLevels = table;
+    levels = table.get();
+    loadLevel(0);
+}
+
+void World::reloadLevel() {
+    Sprite p = player, q = partner;
+    loadLevel(currLevel);
+    player = p;
+    partner = q;
+}
+
+// ============================================================================
+// PORTAL + ITEM CHECKS
+// ============================================================================
+
+void World::checkPortalCollision() {
+    int gx = player.x / TILE_SIZE;
+    int gy = player.y / TILE_SIZE;
+
+    if (justTeleported && spawnPortalID >= 0) {
+        Portal* spawnP = findPortalByID(spawnPortalID);
+        if (spawnP && (spawnP->gridX != gx || spawnP->gridY-1 != gy)) {
+            justTeleported = false;
+            log("Player moved off spawn portal -- teleport enabled.\n");
+        }
+        return;
+    }
+
+    for (const auto& p : portals) {
+        if (gx == p.gridX && gy == p.gridY-1) {
+            log("Entered Portal ID %d -- going to Level %d\n", p.portalID, p.targetLevel);
+            loadLevel(p.targetLevel, p.targetPortalID);
+            return;
+        }
+    }
+}
+
+void World::checkItemPickup() {
+    checkItemPickup(player);
+    if (hasPartner) checkItemPickup(partner);
+}
+
+void World::checkItemPickup(const Sprite& who) {
+    int gx = who.x / TILE_SIZE;
+    int gy = who.y / TILE_SIZE;
+    for (auto it = berries.begin(); it != berries.end(); ) {
+        if (gx == it->gridX && gy == it->gridY-1) {
+            log("pickedup berry\n");
+            inventory.add(ITEM_BERRY, 1);
+            events.berriesPicked++;
+            it = berries.erase(it);
+            return;
+        } else {
+            ++it;
+        }
+    }
+}
+
+void World::checkEnemyCollision() {
+    const float reach = TILE_SIZE * 0.8f;
+    bool hit = false;
+
+    for (const Sprite* who : {&player, hasPartner ? &partner : nullptr}) {
+        if (!who) continue;
+        entityHash.forEachNear(who->x, who->y, reach, [&](const EntityRef& e) {
+            if (hit || e.kind != ENTITY_ENEMY || !enemies[e.index].alive) return;
+            float dx = who->x - e.x;
+            float dy = who->y - e.y;
+            if (sqrt(dx * dx + dy * dy) < reach) hit = true;
+        });
+    }
+
+    if (hit) {
+        log("Hit by enemy! Reloading level...\n");
+        events.playerHit = true;
+        loadLevel(currLevel);
+        rebuildEntityHash();
+    }
+}
+
+// Fires are looked up around, enemies then handled in their own order
+void World::checkEnemyFire() {
+    if (fires.empty()) return;
+
+    const float reach = TILE_SIZE * 0.8f;
+    enemyNearFire.assign(enemies.size(), 0);
+
+    for (const auto& fire : fires) {
+        float fireX = fire[0] * TILE_SIZE;
+        float fireY = fire[1] * TILE_SIZE;
+        entityHash.forEachNear(fireX, fireY, reach, [&](const EntityRef& e) {
+            if (e.kind != ENTITY_ENEMY) return;
+            float dx = fireX - e.x;
+            float dy = fireY - e.y;
+            if (sqrt(dx * dx + dy * dy) < reach) enemyNearFire[e.index] = 1;
+        });
+    }
+
+    for (size_t i = 0; i < enemies.size(); i++) {
+        if (!enemyNearFire[i]) continue;
+        Enemy& enemy = enemies[i];
+        log("Enemy roasted!\n");
+        if (enemy.alive) events.enemiesRoasted++;
+        enemy.tex = &deadantTex;
+        enemy.alive = false;
+    }
+}
+
+// ============================================================================
+// PEBBLE SYSTEM
+// ============================================================================
+
+static void feetGrid(float x, float y, int& gx, int& gy) {
+    const float COLLISION_HEIGHT = TILE_SIZE / 4.0f;
+    const float COLLISION_TOP_OFFSET = TILE_SIZE - COLLISION_HEIGHT;
+
+    float feetX = x + TILE_SIZE * 0.5f;
+    float feetY = y + COLLISION_TOP_OFFSET + COLLISION_HEIGHT * 0.5f;
+
+    gx = (int)(feetX / TILE_SIZE);
+    gy = (int)(feetY / TILE_SIZE);
+}
+
+void World::getPlayerFeetGrid(int& gx, int& gy) const {
+    feetGrid(player.x, player.y, gx, gy);
+}
+
+void World::startPushingPebble(float playerX, float playerY,
+                               float pushDirX, float pushDirY)
+{
+    int playerGridX, playerGridY;
+    feetGrid(playerX, playerY, playerGridX, playerGridY);
+
+    int checkGridX = playerGridX + (pushDirX > 0 ? 1 : (pushDirX < 0 ? -1 : 0));
+    int checkGridY = playerGridY + (pushDirY > 0 ? 1 : (pushDirY < 0 ? -1 : 0));
+
+    for (auto& pebble : pebbles) {
+        if (pebble.isSliding) continue;
+
+        int pebbleGridX = (int)(pebble.x / TILE_SIZE);
+        int pebbleGridY = (int)(pebble.y / TILE_SIZE);
+
+        if (pebbleGridX == checkGridX &&
+            pebbleGridY == checkGridY)
+        {
+            if (!pebble.isBeingPushed) {
+                pebble.isBeingPushed = true;
+                pebble.pushStartTime = nowMs;
+                pebble.pushDirX = pushDirX;
+                pebble.pushDirY = pushDirY;
+
+                log(
+                    "PUSH pebble at [%d,%d] from feet [%d,%d] dir [%.0f,%.0f]\n",
+                    pebbleGridX, pebbleGridY,
+                    playerGridX, playerGridY,
+                    pushDirX, pushDirY
+                );
+            }
+            return;
+        }
+    }
+}
+
+void World::stopPushingPebbles() {
+    for (auto& pebble : pebbles) {
+        if (pebble.isBeingPushed) {
+            pebble.isBeingPushed = false;
+            log("Stopped pushing pebble.\n");
+        }
+    }
+}
+
+void World::updatePebbles() {
+    long long now = nowMs;
+
+    for (auto& pebble : pebbles) {
+        // Check if push duration reached 0.5 seconds
+        if (pebble.isBeingPushed && !pebble.isSliding) {
+            if (now - pebble.pushStartTime >= 500) {
+                // Try to slide the pebble
+                int currentGridX = (int)round(pebble.x / TILE_SIZE);
+                int currentGridY = (int)round(pebble.y / TILE_SIZE);
+
+                int targetX = currentGridX + (int)pebble.pushDirX;
+                int targetY = currentGridY + (int)pebble.pushDirY;
+
+                log("Trying to slide pebble from [%d,%d] to [%d,%d]\n",
+                    currentGridX, currentGridY, targetX, targetY);
+
+                // Check if target tile is free
+                if (!checkCollision(targetX * TILE_SIZE, targetY * TILE_SIZE) &&
+                    !checkPebbleCollision(targetX * TILE_SIZE, targetY * TILE_SIZE, &pebble)) {
+
+                    // Start sliding!
+                    pebble.isSliding = true;
+                    pebble.targetGridX = targetX;
+                    pebble.targetGridY = targetY;
+                    pebble.slideProgress = 0.0f;
+                    pebble.isBeingPushed = false;
+                    log("Pebble sliding to [%d,%d]!\n", targetX, targetY);
+                } else {
+                    pebble.isBeingPushed = false;
+                    log("Can't slide pebble - blocked!\n");
+                }
+            }
+        }
+
+        // Handle sliding animation
+        if (pebble.isSliding) {
+            const float SLIDE_SPEED = 0.1f; // Adjust for faster/slower slide
+            pebble.slideProgress += SLIDE_SPEED;
+
+            if (pebble.slideProgress >= 1.0f) {
+                // Reached target
+                pebble.x = pebble.targetGridX * TILE_SIZE;
+                pebble.y = pebble.targetGridY * TILE_SIZE;
+                pebble.isSliding = false;
+                pebble.slideProgress = 0.0f;
+                pebbleCellChanges.push_back({pebble.targetGridX - (int)pebble.pushDirX,
+                                             pebble.targetGridY - (int)pebble.pushDirY});
+                pebbleCellChanges.push_back({pebble.targetGridX, pebble.targetGridY});
+                mapVersion++;
+                log("Pebble finished sliding at [%d,%d].\n", pebble.targetGridX, pebble.targetGridY);
+            } else {
+                // Interpolate position - calculate start position from current and target
+                int startGridX = pebble.targetGridX - (int)pebble.pushDirX;
+                int startGridY = pebble.targetGridY - (int)pebble.pushDirY;
+
+                float startX = startGridX * TILE_SIZE;
+                float startY = startGridY * TILE_SIZE;
+                float targetX = pebble.targetGridX * TILE_SIZE;
+                float targetY = pebble.targetGridY * TILE_SIZE;
+
+                pebble.x = startX + (targetX - startX) * pebble.slideProgress;
+                pebble.y = startY + (targetY - startY) * pebble.slideProgress;
+            }
+        }
+    }
+}
+
+// The cell a pebble blocks for the planners: where it rests, or while it
+// slides, the cell it left until the slide is over
+void World::pebbleRestCell(const Pebble& pebble, int& gx, int& gy) {
+    if (pebble.isSliding) {
+        gx = pebble.targetGridX - (int)pebble.pushDirX;
+        gy = pebble.targetGridY - (int)pebble.pushDirY;
+    } else {
+        gx = (int)round(pebble.x / TILE_SIZE);
+        gy = (int)round(pebble.y / TILE_SIZE);
+    }
+}
+
+// A pebble counts as sitting on the cell it slides from until the slide
+// finishes, matching when updatePebbles reports the change.
+bool World::pebbleRestsAt(int gx, int gy) const {
+    for (const auto& pebble : pebbles) {
+        int px, py;
+        pebbleRestCell(pebble, px, py);
+        if (px == gx && py == gy) return true;
+    }
+    return false;
+}
+
+// Walls and resting pebbles block sight; both only change with mapVersion
+void World::syncOccluders() {
+    if (sight.current(mapVersion)) return;
+
+    uint8_t opaque[ROWS * COLS];
+    for (int r = 0; r < ROWS; r++)
+        for (int c = 0; c < COLS; c++)
+            opaque[r * COLS + c] = levelTiles[r][c] == 1;
+    for (const auto& pebble : pebbles) {
+        int px, py;
+        pebbleRestCell(pebble, px, py);
+        if (px >= 0 && px < COLS && py >= 0 && py < ROWS) opaque[py * COLS + px] = 1;
+    }
+    sight.setOccluders(opaque, COLS, ROWS, mapVersion);
+}
+
+// ============================================================================
+// ENEMY AI
+// ============================================================================
+
+PathGrid World::pathGrid() const {
+    PathGrid grid;
+    grid.width = COLS;
+    grid.height = ROWS;
+    grid.tiles = &levelTiles[0][0];
+    return grid;
+}
+
+bool World::findPath(int startX, int startY, int goalX, int goalY, GridPath& outPath) const {
+    return ::findPath(levels[currLevel].pathMode, pathGrid(), startX, startY, goalX, goalY, outPath);
+}
+
+void World::enemyGridCell(const Enemy& enemy, const EnemyPath& pathData, int& gx, int& gy) const {
+    if (!pathData.isMoving) {
+        gx = (int)round(enemy.x / TILE_SIZE);
+        gy = (int)round(enemy.y / TILE_SIZE);
+    } else {
+        gx = pathData.startGridX;
+        gy = pathData.startGridY;
+    }
+}
+
+void World::playerChaseCell(const Sprite& who, int& gx, int& gy) const {
+    const float COLLISION_HEIGHT = TILE_SIZE / 4.0f;
+    const float COLLISION_TOP_OFFSET = TILE_SIZE - COLLISION_HEIGHT;
+    float playerFeetY = who.y + COLLISION_TOP_OFFSET + (COLLISION_HEIGHT / 2.0f);
+
+    gx = (int)(who.x / TILE_SIZE);
+    gy = (int)(playerFeetY / TILE_SIZE);
+}
+
+// This tick's CHASE_INTERCEPT candidates for each player
+void World::predictIntercepts() {
+    const float COLLISION_HEIGHT = TILE_SIZE / 4.0f;
+    const float FEET_OFFSET = TILE_SIZE - COLLISION_HEIGHT / 2.0f;
+
+    PathGrid grid = pathGrid();
+    const Sprite* who[2] = {&player, &partner};
+    const PlayerMotion* motion[2] = {&playerMotion, &partnerMotion};
+    for (int p = 0; p < (hasPartner ? 2 : 1); p++) {
+        interceptTargets[p].predict(grid, who[p]->x, who[p]->y + FEET_OFFSET, *motion[p],
+                                    interceptHorizons, INTERCEPT_STEP_TICKS, TILE_SIZE);
+        interceptTargets[p].fetchMaps(distanceMaps, grid, mapVersion);
+    }
+}
+
+// The candidate of either player an enemy at (fromX, fromY) meets soonest;
+// leaves (toX, toY) alone if it can reach none
+void World::interceptCell(int fromX, int fromY, int& toX, int& toY) const {
+    int best = INT_MAX;
+    for (int p = 0; p < (hasPartner ? 2 : 1); p++) {
+        int gx, gy, meet;
+        if (interceptTargets[p].choose(fromX, fromY, ENEMY_TICKS_PER_CELL, COLS, gx, gy, meet) && meet < best) {
+            best = meet;
+            toX = gx;
+            toY = gy;
+        }
+    }
+}
+
+// Under lineOfSight, points (toX, toY) at what the enemy is after: the
+// nearer player it can see, else the cell it last saw one on, else its
+// patrol cell. True when it has only now caught sight of a player.
+bool World::sightTarget(EnemyPath& pathData, int fromX, int fromY, const uint8_t* const views[2],
+                        const int goalX[2], const int goalY[2], int& toX, int& toY)
+{
+    int cell = fromY * COLS + fromX;
+    int nearest = INT_MAX;
+    for (int p = 0; p < 2; p++) {
+        if (!views[p] || !views[p][cell]) continue;
+        int d = abs(goalX[p] - fromX) + abs(goalY[p] - fromY);
+        if (d < nearest) {
+            nearest = d;
+            toX = goalX[p];
+            toY = goalY[p];
+        }
+    }
+
+    bool spotted = nearest != INT_MAX && !pathData.chasing;
+    pathData.chasing = nearest != INT_MAX;
+    if (pathData.chasing) {
+        pathData.lastSeenX = toX;
+        pathData.lastSeenY = toY;
+        return spotted;
+    }
+
+    if (pathData.lastSeenX == fromX && pathData.lastSeenY == fromY)
+        pathData.lastSeenX = pathData.lastSeenY = -1;
+    if (pathData.lastSeenX >= 0) {
+        toX = pathData.lastSeenX;
+        toY = pathData.lastSeenY;
+        return false;
+    }
+
+    // Arrived, or the last patrol cell could not be reached
+    bool arrived = pathData.patrolX == fromX && pathData.patrolY == fromY;
+    if (pathData.patrolX < 0 || arrived || pathData.path.empty())
+        nextPatrolCell(pathData, fromX, fromY);
+    toX = pathData.patrolX;
+    toY = pathData.patrolY;
+    return false;
+}
+
+// A floor cell near the enemy to patrol to, drawn from the enemy's own
+// sequence so runs replay the same; stays put if none turns up
+void World::nextPatrolCell(EnemyPath& pathData, int fromX, int fromY) {
+    const int TRIES = 16;
+    const int SPAN = 2 * PATROL_RANGE + 1;
+    PathGrid grid = pathGrid();
+    for (int t = 0; t < TRIES; t++) {
+        pathData.patrolSeed = pathData.patrolSeed * 1664525u + 1013904223u;
+        int x = fromX - PATROL_RANGE + (int)(pathData.patrolSeed >> 8) % SPAN;
+        int y = fromY - PATROL_RANGE + (int)(pathData.patrolSeed >> 20) % SPAN;
+        if (abs(x - fromX) + abs(y - fromY) < PATROL_MIN_CELLS) continue;
+        if (!grid.walkable(x, y) || pebbleRestsAt(x, y)) continue;
+        pathData.patrolX = x;
+        pathData.patrolY = y;
+        return;
+    }
+    pathData.patrolX = fromX;
+    pathData.patrolY = fromY;
+}
+
+// Queues a replan for every enemy that is due one this tick, in the order
+// updateEnemies visits them. Cache hits are answered on the spot, and an
+// enemy asking the same question as a queued request joins it.
+void World::requestPaths() {
+    pathCache.setVersion(mapVersion);
+
+    bool intercept = chaseMode == CHASE_INTERCEPT && pathMode() != PATH_INCREMENTAL;
+    if (intercept) predictIntercepts();
+
+    int playerGridX, playerGridY;
+    playerChaseCell(player, playerGridX, playerGridY);
+
+    // The LPA* field is rooted at the first player, so there every enemy
+    // chases them; otherwise each goes for the nearer player
+    int partnerGridX = playerGridX, partnerGridY = playerGridY;
+    if (hasPartner && pathMode() != PATH_INCREMENTAL)
+        playerChaseCell(partner, partnerGridX, partnerGridY);
+
+    // Who sees whom is read from the players' fields of view, which are
+    // rebuilt only when a player enters a cell not seen from since the
+    // map last changed
+    bool sighted = lineOfSight && pathMode() != PATH_INCREMENTAL;
+    const uint8_t* views[2] = {nullptr, nullptr};
+    const int goalX[2] = {playerGridX, partnerGridX}, goalY[2] = {playerGridY, partnerGridY};
+    if (sighted) {
+        views[0] = viewFrom(player);
+        if (hasPartner) views[1] = viewFrom(partner);
+    }
+
+    for (size_t i = 0; i < enemies.size(); i++) {
+        Enemy& enemy = enemies[i];
+        if (!enemy.alive) continue;
+
+        EnemyPath& pathData = enemyPaths[i];
+        if (pathData.isMoving || pathData.awaitingPath || pathData.hasResult) continue;
+        bool due = pathData.framesUntilRecalc <= 0 || pathData.path.empty();
+        if (!due && !intercept && !sighted) continue;
+
+        int fromX, fromY;
+        enemyGridCell(enemy, pathData, fromX, fromY);
+
+        int toX = playerGridX, toY = playerGridY;
+        if (abs(partnerGridX - fromX) + abs(partnerGridY - fromY) < abs(toX - fromX) + abs(toY - fromY)) {
+            toX = partnerGridX;
+            toY = partnerGridY;
+        }
+
+        // Catching sight of a player is worth a search straight away
+        if (sighted && sightTarget(pathData, fromX, fromY, views, goalX, goalY, toX, toY)) due = true;
+        bool intercepting = intercept && (!sighted || pathData.chasing);
+        if (!due && !intercepting) continue;
+
+        // Between replans, only a meeting point that has moved well away
+        // from the end of the path is worth asking again for
+        if (intercepting) {
+            interceptCell(fromX, fromY, toX, toY);
+            if (!due) {
+                const auto& end = pathData.path[pathData.path.size() - 1];
+                if (abs(end.first - toX) + abs(end.second - toY) <= INTERCEPT_DRIFT) continue;
+            }
+        }
+
+        const PathCache::Entry* hit = pathCache.lookup(fromX, fromY, toX, toY);
+        if (hit) {
+            pathData.hasResult = true;
+            pathData.resultFound = hit->found;
+            pathData.resultFromX = fromX;
+            pathData.resultFromY = fromY;
+            pathData.result = hit->path;
+            continue;
+        }
+
+        // A table answer costs one read per cell of the path, so it is
+        // given on the spot too, and cached for the enemies behind
+        if (hops.ready()) {
+            GridPath cells;
+            bool found = hops.findPath(fromX, fromY, toX, toY, cells);
+            PathSpan path;
+            if (found) path = PathSpan(std::make_shared<const GridPath>(std::move(cells)));
+            pathCache.store(fromX, fromY, toX, toY, found, path);
+            pathData.hasResult = true;
+            pathData.resultFound = found;
+            pathData.resultFromX = fromX;
+            pathData.resultFromY = fromY;
+            pathData.result = path;
+            continue;
+        }
+
+        pathData.awaitingPath = true;
+
+        // Ants bunched on one cell all ask the same question
+        PathRequest* same = nullptr;
+        for (auto& req : pathQueue) {
+            if (req.fromX == fromX && req.fromY == fromY &&
+                req.toX == toX && req.toY == toY) {
+                same = &req;
+                break;
+            }
+        }
+        if (same) {
+            same->waiters.push_back((int)i);
+            continue;
+        }
+
+        PathRequest req;
+        req.id = nextRequestId++;
+        req.fromX = fromX;
+        req.fromY = fromY;
+        req.toX = toX;
+        req.toY = toY;
+        req.version = mapVersion;
+        req.waiters.push_back((int)i);
+        pathQueue.push_back(std::move(req));
+    }
+}
+
+bool World::pathsAsync() const {
+    return pathWorker && !plannerTracksPebbles();
+}
+
+// Hands new requests to the PathWorker, with a snapshot of the walls
+// taken once per map version
+void World::postPathQueue() {
+    if (!pathSnapshot || pathSnapshot->version != mapVersion) {
+        auto snapshot = std::make_shared<PathSnapshot>();
+        snapshot->version = mapVersion;
+        snapshot->mode = pathMode();
+        snapshot->width = COLS;
+        snapshot->height = ROWS;
+        snapshot->tiles.assign(&levelTiles[0][0], &levelTiles[0][0] + COLS * ROWS);
+        pathSnapshot = snapshot;
+    }
+
+    for (auto& req : pathQueue) {
+        if (req.posted) continue;
+
+        PathJob job;
+        job.id = req.id;
+        job.fromX = req.fromX;
+        job.fromY = req.fromY;
+        job.toX = req.toX;
+        job.toY = req.toY;
+        job.snapshot = pathSnapshot;
+        if (!pathWorker->post(std::move(job))) break;
+        req.posted = true;
+    }
+}
+
+// Takes whatever the PathWorker finished since last tick. Answers for
+// requests dropped by a level load match nothing and are discarded.
+void World::receivePaths() {
+    PathResult result;
+    while (pathWorker->poll(result)) {
+        for (auto& req : pathQueue) {
+            if (req.id != result.id) continue;
+            req.found = result.found;
+            req.path = result.path;
+            req.finished = true;
+            break;
+        }
+    }
+}
+
+// Spends this tick's PathBudget on the queue, oldest request first. A*
+// requests that run out of budget stay at the front and resume next
+// tick; the other searches are short and always run whole. Only touches
+// the queue, pathSearch and frameArena, so it can run alongside the
+// pebble and fire jobs.
+void World::servePathQueue() {
+    const int TIME_CHECK_STEPS = 64;
+
+    Nanos start = pathBudget.time->now();
+    int spent = 0;
+
+    for (auto& req : pathQueue) {
+        while (!req.finished) {
+            int allowance = INT_MAX;
+            if (pathBudget.maxSteps > 0) {
+                if (spent >= pathBudget.maxSteps) break;
+                allowance = pathBudget.maxSteps - spent;
+            }
+            if (pathBudget.maxMicros > 0) {
+                if (pathBudget.time->now() - start >= pathBudget.maxMicros * NANOS_PER_MICRO)
+                    break;
+                allowance = std::min(allowance, TIME_CHECK_STEPS);
+            }
+            spent += runPathRequest(req, allowance);
+        }
+        if (!req.finished) break;
+    }
+
+    events.pathSteps = spent;
+}
+
+// Advances one request by up to maxSteps; returns the steps used
+int World::runPathRequest(PathRequest& req, int maxSteps) {
+    GridPath cells;
+    int steps = 0;
+
+    switch (pathMode()) {
+        case PATH_ASTAR: {
+            if (!req.started) {
+                pathSearch.begin(pathGrid(), req.fromX, req.fromY, req.toX, req.toY);
+                req.started = true;
+            }
+            int before = pathSearch.stats().pops;
+            if (!pathSearch.step(maxSteps)) return pathSearch.stats().pops - before;
+            steps = pathSearch.stats().pops - before;
+            req.found = pathSearch.found();
+            cells.swap(pathSearch.path());
+            break;
+        }
+        case PATH_INCREMENTAL:
+            // The field is rooted at wherever the player is now, which may
+            // not be where they stood when this was queued
+            req.toX = planner.goalX();
+            req.toY = planner.goalY();
+            req.found = planner.extractPath(req.fromX, req.fromY, cells);
+            steps = (int)cells.size() + 1;
+            break;
+        case PATH_HIERARCHICAL: {
+            HpaStats stats;
+            req.found = hpa.findPath(req.fromX, req.fromY, req.toX, req.toY, cells, &stats);
+            steps = stats.abstractExpansions + stats.refineVisits + 1;
+            break;
+        }
+        default: {
+            PathStats stats;
+            req.found = ::findPath(pathMode(), pathGrid(), req.fromX, req.fromY, req.toX, req.toY,
+                                   cells, &stats, &frameArena);
+            steps = stats.pops + 1;
+            break;
+        }
+    }
+
+    if (req.found)
+        req.path = PathSpan(std::make_shared<const GridPath>(std::move(cells)));
+    req.finished = true;
+    return steps;
+}
+
+// Hands finished requests to their enemies and the cache. Results
+// searched before a pebble slide finished are delivered but not cached.
+void World::deliverPaths() {
+    pathCache.setVersion(mapVersion);
+
+    while (!pathQueue.empty() && pathQueue.front().finished) {
+        PathRequest& req = pathQueue.front();
+        if (req.version == mapVersion)
+            pathCache.store(req.fromX, req.fromY, req.toX, req.toY, req.found, req.path);
+
+        for (int enemy : req.waiters) {
+            EnemyPath& pathData = enemyPaths[enemy];
+            pathData.awaitingPath = false;
+            pathData.hasResult = true;
+            pathData.resultFound = req.found;
+            pathData.resultFromX = req.fromX;
+            pathData.resultFromY = req.fromY;
+            pathData.result = req.path;
+        }
+        pathQueue.pop_front();
+    }
+}
+
+// The enemy may have walked on along its old path while the request
+// waited for budget; join the new path wherever the enemy now stands on it
+bool World::adoptPathResult(EnemyPath& pathData, int gx, int gy) {
+    size_t step = 0;
+    if (gx != pathData.resultFromX || gy != pathData.resultFromY) {
+        step = pathData.result.size();
+        for (size_t i = 0; i < pathData.result.size(); i++) {
+            if (pathData.result[i].first == gx && pathData.result[i].second == gy) {
+                step = i + 1;
+                break;
+            }
+        }
+        if (step == pathData.result.size()) return false;
+    }
+
+    pathData.path = pathData.result;
+    pathData.currentStep = (int)step;
+    pathData.framesUntilRecalc = RECALC_FRAMES + pathData.recalcOffset;
+    pathData.recalcOffset = 0;
+    return true;
+}
+
+PathMode World::pathMode() const {
+    return levels[currLevel].pathMode;
+}
+
+bool World::plannerTracksPebbles() const {
+    return pathMode() == PATH_INCREMENTAL || pathMode() == PATH_HIERARCHICAL;
+}
+
+void World::resetPlanner() {
+    pebbleCellChanges.clear();
+    planner = IncrementalPlanner();
+    hpa = HierarchicalPlanner();
+    if (hops.ready()) seedNextHops();
+
+    int gx, gy;
+    if (pathMode() == PATH_INCREMENTAL) {
+        planner.reset(pathGrid());
+        for (const auto& pebble : pebbles) {
+            pebbleRestCell(pebble, gx, gy);
+            planner.setBlocked(gx, gy, true);
+        }
+    } else if (pathMode() == PATH_HIERARCHICAL) {
+        hpa.build(pathGrid());
+        for (const auto& pebble : pebbles) {
+            pebbleRestCell(pebble, gx, gy);
+            hpa.setBlocked(gx, gy, true);
+        }
+        hpa.rebuildDirty();
+    }
+}
+
+// Tells the planner and next-hop tables whether a pebble now lies on one
+// cell. Unlike a slide it asks nobody to replan; the repair itself waits
+// for the next syncPlanner / syncNextHops.
+void World::refreshPebbleCell(int gx, int gy) {
+    bool blocked = pebbleRestsAt(gx, gy);
+    if (pathMode() == PATH_INCREMENTAL) planner.setBlocked(gx, gy, blocked);
+    else if (pathMode() == PATH_HIERARCHICAL) hpa.setBlocked(gx, gy, blocked);
+    if (hops.ready() && plannerTracksPebbles()) hops.setBlocked(gx, gy, blocked);
+}
+
+// Feeds finished pebble slides (and, for the LPA* field, the player's
+// cell) into the level's planner and brings it up to date.
+void World::syncPlanner() {
+    if (pathMode() == PATH_INCREMENTAL) {
+        for (const auto& c : pebbleCellChanges)
+            planner.setBlocked(c.first, c.second, pebbleRestsAt(c.first, c.second));
+
+        int playerGridX, playerGridY;
+        playerChaseCell(player, playerGridX, playerGridY);
+        planner.setGoal(playerGridX, playerGridY);
+        planner.repair();
+    } else if (pathMode() == PATH_HIERARCHICAL) {
+        for (const auto& c : pebbleCellChanges)
+            hpa.setBlocked(c.first, c.second, pebbleRestsAt(c.first, c.second));
+        hpa.rebuildDirty();
+    }
+
+    replanNearChangedCells();
+}
+
+// Points the next-hop tables at the current walls and pebbles; the rows
+// themselves are walked by the next syncNextHops. A* and JPS walk
+// through pebbles, so on their levels the tables only hold the walls.
+void World::seedNextHops() {
+    if (!nextHopTables || pathMode() == PATH_INCREMENTAL) {
+        hops.clear();
+        return;
+    }
+
+    hops.build(pathGrid());
+    if (plannerTracksPebbles()) {
+        int gx, gy;
+        for (const auto& pebble : pebbles) {
+            pebbleRestCell(pebble, gx, gy);
+            hops.setBlocked(gx, gy, true);
+        }
+    }
+}
+
+// Builds the next-hop tables on the first step of a level, or brings them
+// up to date with this tick's pebble slides
+void World::syncNextHops(JobSystem* jobs) {
+    if (!nextHopTables || pathMode() == PATH_INCREMENTAL) {
+        if (hops.ready()) hops.clear();
+        return;
+    }
+
+    if (!hops.ready()) {
+        seedNextHops();
+    } else if (plannerTracksPebbles()) {
+        for (const auto& c : pebbleCellChanges)
+            hops.setBlocked(c.first, c.second, pebbleRestsAt(c.first, c.second));
+    }
+    hops.rebuildDirty(jobs);
+}
+
+// Enemies whose remaining route runs through or next to a changed cell
+// replan this tick instead of waiting out their timer; with the planner
+// already repaired that replan is cheap.
+void World::replanNearChangedCells() {
+    if (pebbleCellChanges.empty()) return;
+
+    for (size_t e = 0; e < enemies.size(); e++) {
+        if (!enemies[e].alive) continue;
+        EnemyPath& pathData = enemyPaths[e];
+
+        for (size_t i = pathData.currentStep; i < pathData.path.size(); i++) {
+            bool touched = false;
+            for (const auto& c : pebbleCellChanges) {
+                if (abs(pathData.path[i].first - c.first) + abs(pathData.path[i].second - c.second) <= 1) {
+                    touched = true;
+                    break;
+                }
+            }
+            if (touched) {
+                pathData.framesUntilRecalc = 0;
+                break;
+            }
+        }
+    }
+
+    pebbleCellChanges.clear();
+}
+
+void World::updateEnemies() {
+    for (size_t i = 0; i < enemies.size(); i++) {
+        Enemy& enemy = enemies[i];
+        if (!enemy.alive) continue;
+
+        EnemyPath& pathData = enemyPaths[i];
+
+        int enemyGridX, enemyGridY;
+        enemyGridCell(enemy, pathData, enemyGridX, enemyGridY);
+
+        if (!pathData.isMoving && pathData.hasResult) {
+            pathData.hasResult = false;
+            if (!pathData.resultFound) {
+                pathData.path.clear();
+                pathData.framesUntilRecalc = RECALC_FRAMES;
+                pathData.result.clear();
+                continue;
+            }
+            // Off the new path: keep the old one and ask again next tick
+            if (!adoptPathResult(pathData, enemyGridX, enemyGridY))
+                pathData.framesUntilRecalc = 0;
+            pathData.result.clear();
+        }
+
+        pathData.framesUntilRecalc--;
+
+        if (!pathData.isMoving) {
+            if (!pathData.path.empty() && pathData.currentStep < pathData.path.size()) {
+                pathData.startGridX = enemyGridX;
+                pathData.startGridY = enemyGridY;
+                pathData.targetGridX = pathData.path[pathData.currentStep].first;
+                pathData.targetGridY = pathData.path[pathData.currentStep].second;
+                pathData.moveProgress = 0.0f;
+                pathData.isMoving = true;
+
+                int dx = pathData.targetGridX - pathData.startGridX;
+                int dy = pathData.targetGridY - pathData.startGridY;
+
+                if (dx > 0) enemy.angle = -90;
+                else if (dx < 0) enemy.angle = 90;
+                else if (dy > 0) enemy.angle = 0;
+                else if (dy < 0) enemy.angle = 180;
+            }
+        }
+
+        if (pathData.isMoving) {
+            pathData.moveProgress += ENEMY_MOVE_SPEED;
+
+            if (pathData.moveProgress >= 1.0f) {
+                pathData.moveProgress = 1.0f;
+                pathData.isMoving = false;
+                pathData.currentStep++;
+
+                enemy.x = pathData.targetGridX * TILE_SIZE;
+                enemy.y = pathData.targetGridY * TILE_SIZE;
+
+                if (pathData.currentStep >= pathData.path.size()) {
+                    pathData.framesUntilRecalc = 0;
+                }
+            } else {
+                float startX = pathData.startGridX * TILE_SIZE;
+                float startY = pathData.startGridY * TILE_SIZE;
+                float targetX = pathData.targetGridX * TILE_SIZE;
+                float targetY = pathData.targetGridY * TILE_SIZE;
+
+                enemy.x = startX + (targetX - startX) * pathData.moveProgress;
+                enemy.y = startY + (targetY - startY) * pathData.moveProgress;
+            }
+        }
+    }
+}
+
+// ============================================================================
+// UPDATE LOOP
+// ============================================================================
+
+// Moves `who` by INPUT_* bits; true while they push against something
+bool World::movePlayer(Sprite& who, uint8_t inputBits) {
+    float dx = 0, dy = 0;
+    float pushDirX = 0, pushDirY = 0;
+    bool isPushing = false;
+
+    if (inputBits & INPUT_UP)    { dy -= PLAYER_SPEED; pushDirY = -1; isPushing = true; }
+    if (inputBits & INPUT_DOWN)  { dy += PLAYER_SPEED; pushDirY = 1; isPushing = true; }
+    if (inputBits & INPUT_LEFT)  { dx -= PLAYER_SPEED; pushDirX = -1; isPushing = true; }
+    if (inputBits & INPUT_RIGHT) { dx += PLAYER_SPEED; pushDirX = 1; isPushing = true; }
+
+    const float COLLISION_HEIGHT = TILE_SIZE/4.0f;
+    const float COLLISION_TOP_OFFSET = TILE_SIZE - COLLISION_HEIGHT;
+    const float INSET = 1.0f;
+
+    float nextX = who.x + dx;
+    bool blockX = false;
+
+    if (checkCollision(nextX+INSET, who.y+COLLISION_TOP_OFFSET)) blockX = true;
+    if (checkCollision(nextX+INSET, who.y+TILE_SIZE-INSET)) blockX = true;
+    if (checkCollision(nextX+TILE_SIZE-INSET, who.y+COLLISION_TOP_OFFSET)) blockX = true;
+    if (checkCollision(nextX+TILE_SIZE-INSET, who.y+TILE_SIZE-INSET)) blockX = true;
+
+    if (blockX && pushDirX != 0 && isPushing) {
+        startPushingPebble(who.x, who.y, pushDirX, 0);
+    }
+
+    if (!blockX) who.x = nextX;
+
+    float nextY = who.y + dy;
+    bool blockY = false;
+
+    if (checkCollision(who.x+INSET, nextY+COLLISION_TOP_OFFSET)) blockY = true;
+    if (checkCollision(who.x+TILE_SIZE-INSET, nextY+COLLISION_TOP_OFFSET)) blockY = true;
+    if (checkCollision(who.x+INSET, nextY+TILE_SIZE-INSET)) blockY = true;
+    if (checkCollision(who.x+TILE_SIZE-INSET, nextY+TILE_SIZE-INSET)) blockY = true;
+
+    if (blockY && pushDirY != 0 && isPushing) {
+        startPushingPebble(who.x, who.y, 0, pushDirY);
+    }
+
+    if (!blockY) who.y = nextY;
+
+    return isPushing && (blockX || blockY);
+}
+
+void World::rebuildEntityHash() {
+    entityHash.clear();
+    entityHash.insert(ENTITY_PLAYER, 0, player.x, player.y);
+    if (hasPartner) entityHash.insert(ENTITY_PLAYER, 1, partner.x, partner.y);
+    for (size_t i = 0; i < enemies.size(); i++)
+        entityHash.insert(ENTITY_ENEMY, (int)i, enemies[i].x, enemies[i].y);
+    for (size_t i = 0; i < pebbles.size(); i++)
+        if (pebbles[i].isSliding)
+            entityHash.insert(ENTITY_PEBBLE, (int)i, pebbles[i].x, pebbles[i].y);
+}
+
+void World::checkContacts() {
+    checkPortalCollision();
+    checkItemPickup();
+
+    // Positions are final for the tick once enemies have moved (and any
+    // portal has loaded its level)
+    rebuildEntityHash();
+    checkEnemyCollision();
+    checkEnemyFire();
+}
+
+// Tick phases:
+//   movePlayer                       (may start pebble pushes)
+//   updatePebbles | path queue | fire automaton   (disjoint state)
+//   deliverPaths, updateEnemies      (applies the searched paths)
+//   checkContacts                    (may reload the level)
+// Enemies due a replan queue requests beforehand; servePathQueue then
+// spends the tick's PathBudget on the queue, reading only levelTiles and
+// the planners; with a PathWorker they are posted to it instead and the
+// answers picked up at the start of a later tick. Pebbles only touch
+// pebbles, and the fire automaton only touches items/fires. On
+// PATH_INCREMENTAL / PATH_HIERARCHICAL levels the planner is synced after
+// updatePebbles and the path queries run after that.
+void World::step(uint8_t inputBits, long long timeMs, JobSystem* jobs) {
+    uint64_t allocsBefore = heapAllocations();
+    nowMs = timeMs;
+    events = TickEvents();
+
+    // Searches done off-thread since last tick are applied before anything
+    // moves; new requests go out as soon as they are known
+    bool async = pathsAsync();
+    if (async) receivePaths();
+
+    // Pushes stop once nobody is pressing against a pebble
+    float playerX = player.x, playerY = player.y;
+    float partnerX = partner.x, partnerY = partner.y;
+    bool pushing = movePlayer(player, inputBits & INPUT_PLAYER_MASK);
+    if (hasPartner && movePlayer(partner, inputBits >> INPUT_PARTNER_SHIFT)) pushing = true;
+    if (!pushing) stopPushingPebbles();
+    playerMotion.update(player.x - playerX, player.y - playerY);
+    if (hasPartner) partnerMotion.update(partner.x - partnerX, partner.y - partnerY);
+
+    // Planners that track pebbles need this tick's pebble moves before any
+    // path is read from them, so on those levels path work follows pebbles
+    bool pebbleAware = plannerTracksPebbles();
+    if (!pebbleAware) {
+        syncNextHops(jobs);
+        requestPaths();
+    }
+    if (async) postPathQueue();
+
+    bool burnDue = nowMs >= nextBurnMs;
+    if (burnDue) nextBurnMs = nowMs + 50;
+
+    if (jobs) {
+        JobHandle pebbleJob = jobs->add([this] { updatePebbles(); });
+        JobHandle fireJob = burnDue ? jobs->add([this] { updateBurns(); }) : JobHandle();
+        if (pebbleAware) {
+            jobs->wait(pebbleJob);
+            syncPlanner();
+            syncNextHops(jobs);
+            requestPaths();
+        }
+        JobHandle pathJob = async ? JobHandle() : jobs->add([this] { servePathQueue(); });
+        jobs->wait(pebbleJob);
+        jobs->wait(fireJob);
+        jobs->wait(pathJob);
+    } else {
+        updatePebbles();
+        if (pebbleAware) {
+            syncPlanner();
+            syncNextHops(nullptr);
+            requestPaths();
+        }
+        if (!async) servePathQueue();
+        if (burnDue) updateBurns();
+    }
+
+    // A* and JPS ignore pebbles; drop their changes so they do not pile up
+    pebbleCellChanges.clear();
+    deliverPaths();
+
+    updateEnemies();
+    checkContacts();
+
+    frameArena.reset();
+    events.heapAllocs = (int)(heapAllocations() - allocsBefore);
+}
+
+// ============================================================================
+// FIRE / BURN LOGIC
+// ============================================================================
+
+void World::checkAndPropagateBurn(int gx, int gy) {
+    int nbr[8][2] = {
+        {gx, gy-1}, {gx, gy+1}, {gx-1, gy}, {gx+1, gy},
+        {gx-1, gy-1}, {gx-1, gy+1}, {gx+1, gy-1}, {gx+1, gy+1}
+    };
+
+    for (int i=0;i<8;i++) {
+        int nx = nbr[i][0];
+        int ny = nbr[i][1];
+
+        if (nx<0||nx>=COLS||ny<0||ny>=ROWS) continue;
+
+        for (auto& s : items) {
+            if ((int)(s.x/TILE_SIZE) == nx &&
+                (int)(s.y/TILE_SIZE) == ny &&
+                s.tex == &itemTex)
+            {
+                s.tex = &flameTex;
+                fires.push_back({nx,ny});
+                s.burnEndTime = nowMs + 500;
+                log("Fire spread to [%d,%d]\n", nx, ny);
+                break;
+            }
+        }
+    }
+}
+
+void World::updateBurns() {
+    long long now = nowMs;
+
+    for (auto it = items.begin(); it != items.end();) {
+        if (it->tex == &flameTex && now >= it->burnEndTime) {
+            int gx = it->x / TILE_SIZE;
+            int gy = it->y / TILE_SIZE;
+            fires.clear();
+            spreadQueue.push_back({gx, gy});
+            occupiedPositions.erase({gx, gy});
+
+            it = items.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (auto& e : spreadQueue)
+        checkAndPropagateBurn(e.gridX, e.gridY);
+
+    spreadQueue.clear();
+}
+
+// ============================================================================
+// TOOLS
+// ============================================================================
+
+void World::useTool(int gx, int gy) {
+    if (placeMode == 1 && inventory.count(ITEM_BAG) > 0) {
+        if (gx>=0&&gx<COLS&&gy>=0&&gy<ROWS) {
+            if (levelTiles[gy][gx] == 0) {
+                if (!occupiedPositions.count({gx,gy})) {
+                    Sprite s;
+                    s.x = gx*TILE_SIZE;
+                    s.y = gy*TILE_SIZE;
+                    s.tex = &itemTex;
+                    items.push_back(s);
+
+                    occupiedPositions.insert({gx,gy});
+                    inventory.take(ITEM_BAG, 1);
+                }
+            }
+            else {
+                log("Cannot place item on wall.\n");
+            }
+        }
+    }
+
+    else if (placeMode == 2) {
+        for (auto& s : items) {
+            if ((int)(s.x/TILE_SIZE)==gx &&
+                (int)(s.y/TILE_SIZE)==gy &&
+                s.tex == &itemTex)
+            {
+                s.tex = &flameTex;
+                fires.push_back({gx,gy});
+                s.burnEndTime = nowMs + 500;
+                break;
+            }
+        }
+    }
+}
+
+void World::clearItems() {
+    items.clear();
+    occupiedPositions.clear();
+}
+
+// ============================================================================
+// OBSERVATION
+// ============================================================================
+
+static void markCell(uint8_t* grid, float x, float y, uint8_t code) {
+    int gx = (int)(x / TILE_SIZE);
+    int gy = (int)(y / TILE_SIZE);
+    if (gx < 0 || gx >= COLS || gy < 0 || gy >= ROWS) return;
+    grid[gy * COLS + gx] = code;
+}
+
+const uint8_t* World::viewFrom(const Sprite& who) {
+    syncOccluders();
+    int gx, gy;
+    playerChaseCell(who, gx, gy);
+    return sight.from(gx, gy);
+}
+
+void World::observe(uint8_t* grid) const {
+    for (int r = 0; r < ROWS; r++)
+        for (int c = 0; c < COLS; c++)
+            grid[r * COLS + c] = levelTiles[r][c] == 1 ? CELL_WALL : CELL_FLOOR;
+
+    for (const auto& p : portals)
+        markCell(grid, p.gridX * TILE_SIZE, p.gridY * TILE_SIZE, CELL_PORTAL);
+    for (const auto& b : berries)
+        markCell(grid, b.gridX * TILE_SIZE, b.gridY * TILE_SIZE, CELL_BERRY);
+    for (const auto& s : items)
+        markCell(grid, s.x, s.y, s.tex == &flameTex ? CELL_FIRE : CELL_ITEM);
+    for (const auto& p : pebbles)
+        markCell(grid, p.x, p.y, CELL_PEBBLE);
+    for (const auto& e : enemies)
+        markCell(grid, e.x + TILE_SIZE * 0.5f, e.y + TILE_SIZE * 0.5f,
+                 e.alive ? CELL_ENEMY : CELL_DEAD_ENEMY);
+
+    int gx, gy;
+    if (hasPartner) {
+        feetGrid(partner.x, partner.y, gx, gy);
+        markCell(grid, gx * TILE_SIZE, gy * TILE_SIZE, CELL_PLAYER);
+    }
+    getPlayerFeetGrid(gx, gy);
+    markCell(grid, gx * TILE_SIZE, gy * TILE_SIZE, CELL_PLAYER);
+}
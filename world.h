@@ -0,0 +1,417 @@
+// ============================================================================
+// world.h
+// SIMULATION STATE - one instance per running game
+// ============================================================================
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <array>
+#include <cstdint>
+#include "Levels.h"
+#include "utils.h"
+#include "pathfinding.h"
+#include "incremental.h"
+#include "hpa.h"
+#include "pathcache.h"
+#include "pathworker.h"
+#include "spatialhash.h"
+#include "inventory.h"
+#include "arena.h"
+#include "clock.h"
+#include "intercept.h"
+#include "visibility.h"
+#include "nexthop.h"
+
+class JobSystem;
+struct GeneratedLevel;
+
+// ============================================================================
+// CONFIGURATION / CONSTANTS
+// ============================================================================
+
+const int TILE_SIZE = 32;
+const int WIN_W = 800;
+const int WIN_H = 600;
+
+const int COLS = WIN_W / TILE_SIZE; // 25 columns
+const int ROWS = WIN_H / TILE_SIZE; // 18 rows
+
+const float PLAYER_SPEED = 2.0f;
+
+// Movement bits for World::step (one per WASD key). The low nibble moves
+// the player; with World::hasPartner the high nibble moves the partner,
+// so both players' input for a tick fits one byte.
+enum InputBits : uint8_t {
+    INPUT_UP    = 1 << 0,
+    INPUT_DOWN  = 1 << 1,
+    INPUT_LEFT  = 1 << 2,
+    INPUT_RIGHT = 1 << 3,
+};
+
+const uint8_t INPUT_PLAYER_MASK = 0x0f;
+const int INPUT_PARTNER_SHIFT = 4;
+
+// Where enemies path to. CHASE_PLAYER goes for the nearer player's cell;
+// CHASE_INTERCEPT for the cell along their recent heading that can be
+// reached soonest (intercept.h). LPA* levels always chase, since their
+// field is rooted at the player.
+enum ChaseMode {
+    CHASE_PLAYER,
+    CHASE_INTERCEPT,
+};
+
+// Cell codes written by World::observe, later entries drawn over earlier ones
+enum CellCode : uint8_t {
+    CELL_FLOOR = 0,
+    CELL_WALL,
+    CELL_PORTAL,
+    CELL_BERRY,
+    CELL_ITEM,
+    CELL_FIRE,
+    CELL_PEBBLE,
+    CELL_ENEMY,
+    CELL_DEAD_ENEMY,
+    CELL_PLAYER,
+};
+
+// Shared textures; Sprite/Enemy point at these, and the pointer identity
+// doubles as item state (bag vs. flame, live vs. dead ant).
+extern Texture playerTex, itemTex, wallTex, floorTex, flameTex, holeTex, berryTex, antTex, deadantTex, pebbleTex;
+
+// The shared textures by a small index that means the same in any build
+// (0xff for a texture that is none of them), for state that is hashed or
+// stored without pointers
+const uint8_t NO_SHARED_TEXTURE = 0xff;
+uint8_t sharedTextureIndex(const Texture* t);
+Texture* sharedTexture(uint8_t index);
+
+// ============================================================================
+// HELPERS & STRUCTURES
+// ============================================================================
+
+struct PairHash {
+    std::size_t operator()(const std::pair<int, int>& p) const {
+        return std::hash<int>()(p.first) ^ (std::hash<int>()(p.second) << 1);
+    }
+};
+
+struct Sprite {
+    float x, y;
+    Texture* tex;
+    long long burnEndTime = 0;
+};
+
+struct Portal {
+    int gridX, gridY;
+    int portalID;
+    int targetLevel;
+    int targetPortalID;
+};
+
+struct Berry {
+    int gridX, gridY;
+    int berryID;
+};
+
+struct Enemy {
+    float x, y;
+    float speed;
+    float angle;
+    Texture* tex;
+    bool alive;
+};
+
+struct Pebble {
+    float x, y;
+    bool isBeingPushed;
+    long long pushStartTime;
+    float pushDirX, pushDirY;
+    bool isSliding;
+    int targetGridX, targetGridY;
+    float slideProgress;
+};
+
+struct BurnCheckEvent {
+    int gridX, gridY;
+};
+
+struct EnemyPath {
+    PathSpan path;
+    int currentStep = 0;
+    int framesUntilRecalc = 0;
+    bool isMoving = false;
+    int startGridX = 0, startGridY = 0;
+    int targetGridX = 0, targetGridY = 0;
+    float moveProgress = 0.0f;
+    int recalcOffset = 0;       // extra frames before the first replan
+
+    // A replan in the queue, and once delivered its answer, picked up by
+    // updateEnemies at the next cell boundary
+    bool awaitingPath = false;
+    bool hasResult = false;
+    bool resultFound = false;
+    int resultFromX = 0, resultFromY = 0;
+    PathSpan result;
+
+    // World::lineOfSight: whether a player is in view, the cell one was
+    // last seen on (-1 once reached) and the cell being patrolled to
+    bool chasing = false;
+    int lastSeenX = -1, lastSeenY = -1;
+    int patrolX = -1, patrolY = -1;
+    uint32_t patrolSeed = 0;
+};
+
+// A replan waiting for search budget. Enemies asking the same question
+// share one request; on PATH_ASTAR levels the search itself may carry
+// over into later ticks, in World::pathSearch.
+struct PathRequest {
+    uint32_t id;
+    int fromX, fromY;
+    int toX, toY;
+    uint32_t version;           // mapVersion when queued
+    std::vector<int> waiters;   // indexes into World::enemies
+    bool posted = false;        // handed to the PathWorker
+    bool started = false;
+    bool finished = false;
+    bool found = false;
+    PathSpan path;
+};
+
+// Search work allowed per tick, spent on queued requests in order. Steps
+// are open-list pops (A*, JPS), abstract expansions plus refine visits
+// (HPA*) or path cells walked (LPA* field); 0 means no limit. maxMicros
+// also stops on wall time, which ties the simulation to machine speed,
+// so only the interactive game sets it. Benchmarks can point `time` at a
+// FakeTime to make that deterministic too.
+struct PathBudget {
+    int maxSteps = 600;
+    int maxMicros = 0;
+    const TimeSource* time = &steadyTime();
+};
+
+// What happened during the last World::step, reset at the start of each step
+struct TickEvents {
+    int berriesPicked = 0;
+    int enemiesRoasted = 0;
+    bool playerHit = false;
+    bool levelChanged = false;
+    int pathSteps = 0;          // search work done, in PathBudget steps
+    int heapAllocs = 0;         // operator new calls during the step, any thread
+};
+
+// ============================================================================
+// WORLD
+// ============================================================================
+
+// Copyable: a copy is an independent world at the same point in the game
+// (with its own, empty frameArena), which is how netplay rolls back.
+struct World {
+    Sprite player;
+
+    // Second player for lockstep netplay (netplay.h). Moves on the high
+    // nibble of step()'s input, follows the player through portals and
+    // can be chased, hit and pick up berries like them.
+    Sprite partner;
+    bool hasPartner = false;
+
+    std::vector<Sprite> items;
+    std::vector<std::array<int, 2>> fires;
+    std::vector<Portal> portals;
+    std::vector<Berry> berries;
+    std::vector<Enemy> enemies;
+    std::vector<Pebble> pebbles;
+
+    std::unordered_set<std::pair<int, int>, PairHash> occupiedPositions;
+
+    // Player, enemies and sliding pebbles by TILE_SIZE cell, rebuilt by
+    // checkContacts so proximity tests only look at neighbouring cells
+    SpatialHash entityHash{(float)TILE_SIZE};
+    std::vector<uint8_t> enemyNearFire;     // checkEnemyFire scratch
+
+    std::vector<BurnCheckEvent> spreadQueue;
+    std::vector<EnemyPath> enemyPaths;      // one per enemy, same index
+
+    ChaseMode chaseMode = CHASE_PLAYER;
+    // Candidate cells per player per tick under CHASE_INTERCEPT, at most
+    // InterceptTargets::MAX_HORIZONS. This is the CPU knob: a changed
+    // candidate costs one walk over the level, an unchanged one nothing.
+    int interceptHorizons = 5;
+    PlayerMotion playerMotion, partnerMotion;
+    DistanceMaps distanceMaps;
+
+    // When set, an enemy chases only players it can see (one whose field
+    // of view takes in the enemy's cell), then heads for the cell it last
+    // saw them on, and otherwise patrols nearby. LPA* levels always chase.
+    bool lineOfSight = false;
+    VisibilityCache sight;      // walls and resting pebbles as of mapVersion
+    InterceptTargets interceptTargets[2];  // player, partner; this tick's
+    std::deque<PathRequest> pathQueue;
+    uint32_t nextRequestId = 0;
+    PathBudget pathBudget;
+
+    // The A* search in progress. Requests are served in order and only the
+    // front one can be part way through, so one search (and its buffers)
+    // does for all of them.
+    AStarSearch pathSearch;
+
+    // Scratch for the tick's transient containers (JPS working sets);
+    // reset at the end of step()
+    FrameArena frameArena;
+
+    // When set, A* / JPS requests are searched on this thread against a
+    // snapshot of the walls instead of within the tick; answers arrive a
+    // tick or more later, so runs are no longer reproducible. Levels whose
+    // planner tracks pebbles keep searching in the tick.
+    PathWorker* pathWorker = nullptr;
+    std::shared_ptr<const PathSnapshot> pathSnapshot;
+
+    // Planners that track pebbles (PATH_INCREMENTAL / PATH_HIERARCHICAL
+    // levels), plus the pebble cells changed since they were last synced
+    IncrementalPlanner planner;
+    HierarchicalPlanner hpa;
+    std::vector<std::pair<int, int>> pebbleCellChanges;
+
+    // When set, enemies on A*, JPS and HPA* levels follow all-pairs
+    // next-hop tables (nexthop.h) instead of searching. They are built on
+    // the first step of a level, across that step's JobSystem, kept when
+    // the level reloads with the same walls, and kept up to date as
+    // pebbles move on levels whose planner tracks them.
+    bool nextHopTables = false;
+    NextHopTable hops;
+
+    // Bumped whenever walkability changes (level load, pebble slide);
+    // pathCache only serves results searched against the current version
+    uint32_t mapVersion = 0;
+    PathCache pathCache;
+
+    // Storage restoreState (rollback.h) decodes saved paths into; an entry
+    // is reused once no enemy or copy of the world still holds it
+    std::vector<std::shared_ptr<GridPath>> restoredPaths;
+
+    // NUM_LEVELS level definitions; the built-in tables unless the level
+    // editor has pointed this at its own editable copy
+    const LevelData* levels = Levels;
+    const int (*levelTiles)[25] = nullptr;
+
+    // Set by loadGenerated: a stress level standing in for every level,
+    // with its entity lists kept here since they can outgrow a LevelData.
+    // generatedLevels is the NUM_LEVELS table `levels` then points at.
+    std::shared_ptr<const GeneratedLevel> generated;
+    std::shared_ptr<const LevelData[]> generatedLevels;
+    int currLevel = 0;
+
+    int placeMode = 1; // 1=place, 2=burn, EDIT_* brushes in the editor
+
+    bool justTeleported = false;
+    int spawnPortalID = -1;
+    Inventory inventory;        // berries carry over; bags refill per level
+
+    long long nowMs = 0;        // clock value handed to the current step
+    long long nextBurnMs = 0;   // when the fire automaton runs next
+    TickEvents events;
+
+    bool verbose = true;        // printf progress messages
+
+    World();
+
+    // Advances one fixed tick: movement, pebbles, enemies, pickups and,
+    // every 50 ms of clock time, the fire automaton. With a job system the
+    // pebble, path search and fire phases run concurrently; the result is
+    // identical either way.
+    void step(uint8_t inputBits, long long timeMs, JobSystem* jobs = nullptr);
+
+    // Mouse action on a grid cell according to placeMode
+    void useTool(int gx, int gy);
+    void clearItems();
+
+    void loadLevel(int levelIndex, int fromPortalID = -1);
+
+    // Plays a generated level (levelgen.h) instead of the level table.
+    // It has to be COLS x ROWS; the entity counts are unlimited.
+    void loadGenerated(const GeneratedLevel& level);
+
+    // Rebuilds the current level from its (edited) definition, keeping the
+    // player where they stand
+    void reloadLevel();
+
+    // Writes ROWS*COLS CellCode bytes, row-major
+    void observe(uint8_t* grid) const;
+
+    // Cells `who` can see from where they stand, ROWS*COLS bytes, nonzero
+    // for visible (nullptr off the grid). Cached per cell and map version,
+    // so calling it every tick costs a lookup.
+    const uint8_t* viewFrom(const Sprite& who);
+
+    void log(const char* fmt, ...) const;
+
+    // --- collision ---
+    bool checkCollision(float newX, float newY);
+    bool checkPebbleCollision(float x, float y, Pebble* ignorePebble = nullptr);
+    void rebuildEntityHash();
+
+    // --- level loading ---
+    void loadPortals();
+    void loadBerries();
+    void loadEnemies();
+    void loadPebbles();
+    void addBerry(const BerryDef& def);
+    void addEnemy(const EnemyDef& def);
+    void addPebble(const PebbleDef& def);
+    Portal* findPortalByID(int portalID);
+
+    // --- portal + item checks ---
+    void checkPortalCollision();
+    void checkItemPickup();
+    void checkItemPickup(const Sprite& who);
+    void checkEnemyCollision();
+    void checkEnemyFire();
+
+    // --- pebbles ---
+    void getPlayerFeetGrid(int& gx, int& gy) const;
+    void startPushingPebble(float playerX, float playerY, float pushDirX, float pushDirY);
+    void stopPushingPebbles();
+    void updatePebbles();
+    bool pebbleRestsAt(int gx, int gy) const;
+    static void pebbleRestCell(const Pebble& pebble, int& gx, int& gy);
+    void syncOccluders();
+
+    // --- enemy AI ---
+    PathGrid pathGrid() const;
+    bool findPath(int startX, int startY, int goalX, int goalY, GridPath& outPath) const;
+    void enemyGridCell(const Enemy& enemy, const EnemyPath& pathData, int& gx, int& gy) const;
+    void playerChaseCell(const Sprite& who, int& gx, int& gy) const;
+    void predictIntercepts();
+    void interceptCell(int fromX, int fromY, int& toX, int& toY) const;
+    bool sightTarget(EnemyPath& pathData, int fromX, int fromY, const uint8_t* const views[2],
+                     const int goalX[2], const int goalY[2], int& toX, int& toY);
+    void nextPatrolCell(EnemyPath& pathData, int fromX, int fromY);
+    void requestPaths();
+    bool pathsAsync() const;
+    void postPathQueue();
+    void receivePaths();
+    void servePathQueue();
+    int runPathRequest(PathRequest& req, int maxSteps);
+    void deliverPaths();
+    bool adoptPathResult(EnemyPath& pathData, int gx, int gy);
+    PathMode pathMode() const;
+    bool plannerTracksPebbles() const;
+    void resetPlanner();
+    void refreshPebbleCell(int gx, int gy);
+    void syncPlanner();
+    void seedNextHops();
+    void syncNextHops(JobSystem* jobs);
+    void replanNearChangedCells();
+    void updateEnemies();
+
+    // --- fire / burn ---
+    void checkAndPropagateBurn(int gx, int gy);
+    void updateBurns();
+
+    bool movePlayer(Sprite& who, uint8_t inputBits);
+    void checkContacts();
+};